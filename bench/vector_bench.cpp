@@ -0,0 +1,355 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_BENCH.CPP
+   -----------------------------------------------------------------------------
+   Benchmarks vector.h against std::vector and a raw array across element
+   sizes, printing ns/op and bytes allocated per operation.
+
+   BUILD:
+	 c++ -O2 -std=c++17 -I.. vector_bench.cpp -o vector_bench
+	 // With memarena on the include path, also benchmark arena_allocator:
+	 c++ -O2 -std=c++17 -I.. -I<memarena> -DBENCH_WITH_ARENA vector_bench.cpp -o vector_bench
+
+   USAGE:
+	 ./vector_bench [scale]
+
+	 scale multiplies the element counts (default 1). Output is one
+	 whitespace-separated row per op/elem_size/impl, so two runs can be diffed
+	 or fed to a script to spot regressions.
+*/
+
+#define VECTOR_IMPLEMENTATION
+#include "vector.h"
+#ifdef BENCH_WITH_ARENA
+# include <sys/mman.h>
+# include "vector_arena.h"
+# ifndef BENCH_ARENA_DESTROY
+#  define BENCH_ARENA_DESTROY(arena) arena_destroy(arena)
+# endif
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/* ======================== */
+/* -- Allocation counter -- */
+/* ======================== */
+
+/* Total bytes requested through alloc/realloc by every implementation. */
+static size_t g_bytes = 0;
+
+typedef struct {
+	Allocator	inner;
+} CountingCtx;
+
+static void *counting_alloc(void *ctx, size_t size, size_t align)
+{
+	CountingCtx *c = (CountingCtx *)ctx;
+
+	g_bytes += size;
+	return (c->inner.alloc(c->inner.ctx, size, align));
+}
+
+static void *counting_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align)
+{
+	CountingCtx *c = (CountingCtx *)ctx;
+
+	g_bytes += new_size;
+	return (c->inner.realloc(c->inner.ctx, ptr, old_size, new_size, align));
+}
+
+static void counting_free(void *ctx, void *ptr)
+{
+	CountingCtx *c = (CountingCtx *)ctx;
+
+	c->inner.free(c->inner.ctx, ptr);
+}
+
+static size_t counting_usable(void *ctx, void *ptr, size_t size)
+{
+	CountingCtx *c = (CountingCtx *)ctx;
+
+	return (c->inner.usable_size(c->inner.ctx, ptr, size));
+}
+
+static bool counting_expand(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+	CountingCtx *c = (CountingCtx *)ctx;
+
+	if (!c->inner.expand_in_place(c->inner.ctx, ptr, old_size, new_size))
+		return (false);
+	g_bytes += new_size - old_size;
+	return (true);
+}
+
+static void *counting_alloc_zeroed(void *ctx, size_t size, size_t align)
+{
+	CountingCtx *c = (CountingCtx *)ctx;
+
+	g_bytes += size;
+	return (c->inner.alloc_zeroed(c->inner.ctx, size, align));
+}
+
+/* Wraps inner so every byte it hands out is counted, keeping its optional hooks. */
+static Allocator counting_allocator(CountingCtx *ctx, Allocator inner)
+{
+	Allocator a;
+
+	ctx->inner = inner;
+	a.alloc = counting_alloc;
+	a.realloc = inner.realloc ? counting_realloc : NULL;
+	a.free = inner.free ? counting_free : NULL;
+	a.ctx = ctx;
+	a.usable_size = inner.usable_size ? counting_usable : NULL;
+	a.expand_in_place = inner.expand_in_place ? counting_expand : NULL;
+	a.alloc_zeroed = inner.alloc_zeroed ? counting_alloc_zeroed : NULL;
+	return (a);
+}
+
+template <typename T>
+struct CountingStdAlloc
+{
+	typedef T value_type;
+
+	CountingStdAlloc() {}
+	template <typename U> CountingStdAlloc(const CountingStdAlloc<U> &) {}
+
+	T *allocate(size_t n)
+	{
+		g_bytes += n * sizeof(T);
+		return (static_cast<T *>(std::malloc(n * sizeof(T))));
+	}
+	void deallocate(T *p, size_t) { std::free(p); }
+
+	template <typename U> bool operator==(const CountingStdAlloc<U> &) const { return (true); }
+	template <typename U> bool operator!=(const CountingStdAlloc<U> &) const { return (false); }
+};
+
+/* ====================== */
+/* -- Implementations  -- */
+/* ====================== */
+
+template <size_t N>
+struct Elem
+{
+	unsigned char	bytes[N];
+};
+
+/* vector.h through any Allocator. */
+template <size_t N>
+struct CVector
+{
+	CountingCtx	counting;
+	Vector		v;
+
+	explicit CVector(Allocator alloc) { v = vector_init(counting_allocator(&counting, alloc), N); }
+	~CVector() { vector_destroy(&v); }
+
+	void	reserve(size_t n) { vector_reserve(&v, n); }
+	void	push(Elem<N> &e) { vector_push(&v, &e); }
+	void	insert(size_t i, Elem<N> &e) { vector_insert(&v, i, &e); }
+	void	erase(size_t i) { vector_erase(&v, i); }
+	void	swap_pop(size_t i) { vector_swap_pop(&v, i); }
+	size_t	size() const { return (v.size); }
+	Elem<N>	*data() { return (vector_data_as(&v, Elem<N>)); }
+};
+
+template <size_t N>
+struct StdVector
+{
+	std::vector<Elem<N>, CountingStdAlloc<Elem<N> > >	v;
+
+	void	reserve(size_t n) { v.reserve(n); }
+	void	push(Elem<N> &e) { v.push_back(e); }
+	void	insert(size_t i, Elem<N> &e) { v.insert(v.begin() + i, e); }
+	void	erase(size_t i) { v.erase(v.begin() + i); }
+	void	swap_pop(size_t i) { v[i] = v.back(); v.pop_back(); }
+	size_t	size() const { return (v.size()); }
+	Elem<N>	*data() { return (v.data()); }
+};
+
+/* Fixed array sized up front, the floor every growable vector is compared to. */
+template <size_t N>
+struct RawArray
+{
+	Elem<N>	*arr;
+	size_t	len;
+
+	explicit RawArray(size_t cap) : len(0)
+	{
+		g_bytes += cap * N;
+		arr = static_cast<Elem<N> *>(std::malloc(cap * N));
+	}
+	~RawArray() { std::free(arr); }
+
+	void	reserve(size_t) {}
+	void	push(Elem<N> &e) { arr[len++] = e; }
+	void	insert(size_t i, Elem<N> &e)
+	{
+		memmove(arr + i + 1, arr + i, (len - i) * N);
+		arr[i] = e;
+		len++;
+	}
+	void	erase(size_t i)
+	{
+		memmove(arr + i, arr + i + 1, (len - i - 1) * N);
+		len--;
+	}
+	void	swap_pop(size_t i) { arr[i] = arr[--len]; }
+	size_t	size() const { return (len); }
+	Elem<N>	*data() { return (arr); }
+};
+
+/* ==================== */
+/* -- Benchmarks     -- */
+/* ==================== */
+
+enum Op { OP_PUSH, OP_RESERVE_PUSH, OP_INSERT_FRONT, OP_INSERT_MIDDLE, OP_ERASE_FRONT, OP_SWAP_POP, OP_ITERATE };
+
+static const char *op_names[] = {
+	"push", "reserve+push", "insert_front", "insert_middle", "erase_front", "swap_pop", "iterate"
+};
+
+static volatile unsigned g_sink;
+
+/* Quadratic ops run on far fewer elements so they finish in reasonable time. */
+static size_t op_count(Op op, size_t elem_size, size_t scale)
+{
+	size_t budget = (op == OP_INSERT_FRONT || op == OP_INSERT_MIDDLE || op == OP_ERASE_FRONT)
+		? ((size_t)4 << 20) : ((size_t)64 << 20);
+	size_t n = budget / elem_size * scale;
+
+	if (op == OP_INSERT_FRONT || op == OP_INSERT_MIDDLE || op == OP_ERASE_FRONT)
+		n = n > 20000 * scale ? 20000 * scale : n;
+	return (n > 1000000 * scale ? 1000000 * scale : n);
+}
+
+template <size_t N, typename Impl>
+static double run_op(Impl &impl, Op op, size_t n)
+{
+	Elem<N> e;
+	memset(&e, 0x5a, sizeof(e));
+
+	// Ops that consume elements need them in place before the clock starts
+	if (op == OP_ERASE_FRONT || op == OP_SWAP_POP || op == OP_ITERATE)
+	{
+		impl.reserve(n);
+		for (size_t i = 0; i < n; ++i)
+			impl.push(e);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	switch (op)
+	{
+		case OP_PUSH:
+			for (size_t i = 0; i < n; ++i)
+			{
+				e.bytes[0] = (unsigned char)i;
+				impl.push(e);
+			}
+			break;
+		case OP_RESERVE_PUSH:
+			impl.reserve(n);
+			for (size_t i = 0; i < n; ++i)
+			{
+				e.bytes[0] = (unsigned char)i;
+				impl.push(e);
+			}
+			break;
+		case OP_INSERT_FRONT:
+			for (size_t i = 0; i < n; ++i)
+				impl.insert(0, e);
+			break;
+		case OP_INSERT_MIDDLE:
+			for (size_t i = 0; i < n; ++i)
+				impl.insert(impl.size() / 2, e);
+			break;
+		case OP_ERASE_FRONT:
+			for (size_t i = 0; i < n; ++i)
+				impl.erase(0);
+			break;
+		case OP_SWAP_POP:
+			for (size_t i = 0; i < n; ++i)
+				impl.swap_pop(0);
+			break;
+		case OP_ITERATE:
+		{
+			unsigned sum = 0;
+			Elem<N> *data = impl.data();
+			for (size_t i = 0; i < n; ++i)
+				sum += data[i].bytes[0];
+			g_sink = sum;
+			break;
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	if (impl.size() > 0)
+		g_sink = g_sink + impl.data()[0].bytes[0];
+	return (std::chrono::duration<double, std::nano>(end - start).count());
+}
+
+static void report(Op op, size_t elem_size, const char *impl, double ns, size_t n, size_t bytes)
+{
+	printf("%-14s %6zu %-8s %12.2f %14zu %10.2f\n",
+		op_names[op], elem_size, impl, ns / (double)n, bytes, (double)bytes / (double)n);
+}
+
+template <size_t N>
+static void bench_size(size_t scale)
+{
+	for (int o = OP_PUSH; o <= OP_ITERATE; ++o)
+	{
+		Op		op = (Op)o;
+		size_t	n = op_count(op, N, scale);
+		double	ns;
+
+		{
+			g_bytes = 0;
+			CVector<N> impl(malloc_allocator());
+			ns = run_op<N>(impl, op, n);
+			report(op, N, "malloc", ns, n, g_bytes);
+		}
+#ifdef BENCH_WITH_ARENA
+		{
+			Arena arena = arena_init(PROT_READ | PROT_WRITE);
+			g_bytes = 0;
+			{
+				CVector<N> impl(arena_allocator(&arena));
+				ns = run_op<N>(impl, op, n);
+			}
+			report(op, N, "arena", ns, n, g_bytes);
+			BENCH_ARENA_DESTROY(&arena);
+		}
+#endif
+		{
+			g_bytes = 0;
+			StdVector<N> impl;
+			ns = run_op<N>(impl, op, n);
+			report(op, N, "std", ns, n, g_bytes);
+		}
+		{
+			g_bytes = 0;
+			RawArray<N> impl(n);
+			ns = run_op<N>(impl, op, n);
+			report(op, N, "raw", ns, n, g_bytes);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	size_t scale = argc > 1 ? (size_t)strtoul(argv[1], NULL, 10) : 1;
+
+	if (scale == 0)
+		scale = 1;
+	printf("%-14s %6s %-8s %12s %14s %10s\n", "op", "elem", "impl", "ns/op", "bytes", "bytes/op");
+	bench_size<1>(scale);
+	bench_size<4>(scale);
+	bench_size<16>(scale);
+	bench_size<64>(scale);
+	bench_size<256>(scale);
+	return (0);
+}
@@ -0,0 +1,866 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_STRESS.CPP
+   -----------------------------------------------------------------------------
+   Randomized stress test for vector.h. Runs random operation sequences
+   against a shadow model (a plain byte array per vector) through allocators
+   that fail at random, hand out exactly-aligned or minimally aligned blocks,
+   report slack, expand in place or have no realloc at all. Then measures op
+   throughput over time and fails if it fell below a saved baseline.
+
+   BUILD:
+	 c++ -O2 -std=c++17 -I.. vector_stress.cpp -o vector_stress
+	 // Sanitizers catch what the shadow model can't see:
+	 c++ -O1 -g -std=c++17 -fsanitize=address,undefined -I.. vector_stress.cpp -o vector_stress
+	 // With memarena on the include path, also check arena_allocator's
+	 // rewinds; needs VECTOR_ARENA_IS_LAST and VECTOR_ARENA_MARK mapped,
+	 // see vector_arena.h:
+	 c++ -O2 -std=c++17 -I.. -I<memarena> -DBENCH_WITH_ARENA vector_stress.cpp -o vector_stress
+
+   USAGE:
+	 ./vector_stress [-n ops] [-s seed] [-w file] [-b file] [-t ratio]
+
+	 -n  random operations to run (default 2000000)
+	 -s  seed, printed with every failure so it can be replayed
+	 -w  write the measured throughput (ops/s) to file
+	 -b  compare against the throughput in file, written earlier with -w
+	 -t  fail if throughput < ratio * baseline (default 0.8)
+
+	 Exits 0 when everything passed, 1 on a correctness failure and 2 on a
+	 throughput regression. Build the baseline with the same flags.
+*/
+
+// vector.h asserts on allocation failure, which is what this harness provokes
+// on purpose. Its own checks use STRESS_CHECK, which is always on.
+#ifndef NDEBUG
+# define NDEBUG
+#endif
+
+#define VECTOR_IMPLEMENTATION
+#include "vector.h"
+#ifdef BENCH_WITH_ARENA
+# include <sys/mman.h>
+# include "vector_arena.h"
+# ifndef BENCH_ARENA_DESTROY
+#  define BENCH_ARENA_DESTROY(arena) arena_destroy(arena)
+# endif
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define STRESS_SLOTS		3		// vectors alive at once, clones go between them
+#define STRESS_ROUND_OPS	2000	// ops per allocator/element configuration
+#define STRESS_MAX_BLOCK	((size_t)1 << 30)	// bigger requests are refused as OOM
+#define STRESS_WINDOWS		32		// throughput samples
+
+/* ==================== */
+/* -- Failure report -- */
+/* ==================== */
+
+static unsigned long long	g_seed = 1;
+static size_t				g_op_index = 0;
+static const char			*g_op_name = "setup";
+
+static void stress_fail(int line, const char *cond, const char *what)
+{
+	fprintf(stderr, "FAIL %s (line %d: %s)\n  during %s, op %zu, seed %llu\n",
+		what, line, cond, g_op_name, g_op_index, g_seed);
+	exit(1);
+}
+
+#define STRESS_CHECK(cond, what) \
+	do { if (!(cond)) stress_fail(__LINE__, #cond, (what)); } while (0)
+
+/* xorshift64*, deterministic for a given seed. */
+struct Rng
+{
+	uint64_t	s;
+
+	uint64_t next()
+	{
+		s ^= s >> 12;
+		s ^= s << 25;
+		s ^= s >> 27;
+		return (s * 2685821657736338717ULL);
+	}
+	size_t	below(size_t n) { return (n ? (size_t)(next() % n) : 0); }
+	bool	chance(unsigned per_mille) { return (below(1000) < per_mille); }
+};
+
+/* ====================== */
+/* -- Stress allocator -- */
+/* ====================== */
+
+enum AlignMode
+{
+	ALIGN_NATIVE,	// at least max(align, 16), like malloc
+	ALIGN_EXACT,	// exactly max(align, 16), never more
+	ALIGN_MINIMAL	// exactly align, and only 8 for default requests, like a bump allocator
+};
+
+typedef struct {
+	Rng			rng;
+	unsigned	fail_per_mille;
+	AlignMode	mode;
+	bool		slack;		// blocks get random slack, visible through usable_size
+	size_t		live;		// blocks handed out and not freed yet
+	size_t		failures;	// refused requests, an op failing without one is a bug
+	size_t		calls;
+} StressCtx;
+
+/* Stored right before every block. */
+typedef struct {
+	void	*base;
+	size_t	usable;
+} BlockHeader;
+
+static BlockHeader *block_header(void *ptr)
+{
+	return ((BlockHeader *)((char *)ptr - sizeof(BlockHeader)));
+}
+
+static void *stress_block(StressCtx *c, size_t size, size_t align, bool zero)
+{
+	c->calls++;
+	if (size > STRESS_MAX_BLOCK || c->rng.chance(c->fail_per_mille))
+	{
+		c->failures++;
+		return (NULL);
+	}
+
+	size_t a = align ? align : (c->mode == ALIGN_MINIMAL ? sizeof(size_t) : 16);
+	if (c->mode == ALIGN_NATIVE && a < 16)
+		a = 16;
+	size_t usable = size + (c->slack ? c->rng.below(64) : 0);
+	char *base = (char *)malloc(sizeof(BlockHeader) + usable + 3 * a);
+	STRESS_CHECK(base != NULL, "host malloc failed");
+
+	uintptr_t start = (uintptr_t)base + sizeof(BlockHeader);
+	uintptr_t p = (start + a - 1) & ~(uintptr_t)(a - 1);
+	if (c->mode != ALIGN_NATIVE)
+		p = ((start + 2 * a - 1) & ~(uintptr_t)(2 * a - 1)) + a;
+
+	BlockHeader *h = block_header((void *)p);
+	h->base = base;
+	h->usable = usable;
+	memset((void *)p, zero ? 0 : 0xa5, usable);
+	c->live++;
+	return ((void *)p);
+}
+
+static void *stress_alloc(void *ctx, size_t size, size_t align)
+{
+	return (stress_block((StressCtx *)ctx, size, align, false));
+}
+
+static void *stress_alloc_zeroed(void *ctx, size_t size, size_t align)
+{
+	return (stress_block((StressCtx *)ctx, size, align, true));
+}
+
+static void stress_free(void *ctx, void *ptr)
+{
+	StressCtx *c = (StressCtx *)ctx;
+
+	if (!ptr)
+		return;
+	STRESS_CHECK(c->live > 0, "free without a live block");
+	memset(ptr, 0xdd, block_header(ptr)->usable);
+	free(block_header(ptr)->base);
+	c->live--;
+}
+
+static void *stress_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align)
+{
+	if (ptr)
+		STRESS_CHECK(old_size <= block_header(ptr)->usable, "realloc old_size past the block");
+
+	void *p = stress_block((StressCtx *)ctx, new_size, align, false);
+	if (!p)
+		return (NULL);
+	if (ptr)
+	{
+		memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+		stress_free(ctx, ptr);
+	}
+	return (p);
+}
+
+static size_t stress_usable(void *ctx, void *ptr, size_t size)
+{
+	(void)ctx;
+	STRESS_CHECK(size <= block_header(ptr)->usable, "usable_size asked past the block");
+	return (block_header(ptr)->usable);
+}
+
+/* Succeeds within the block's slack, unless the fault dice say otherwise. */
+static bool stress_expand(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+	StressCtx *c = (StressCtx *)ctx;
+
+	STRESS_CHECK(old_size <= block_header(ptr)->usable, "expand old_size past the block");
+	if (c->rng.chance(c->fail_per_mille))
+		return (false);
+	return (new_size <= block_header(ptr)->usable);
+}
+
+typedef struct {
+	bool	realloc;
+	bool	usable_size;
+	bool	expand;
+	bool	zeroed;
+} StressHooks;
+
+static Allocator stress_allocator(StressCtx *ctx, StressHooks hooks)
+{
+	Allocator a;
+
+	a.alloc = stress_alloc;
+	a.realloc = hooks.realloc ? stress_realloc : NULL;
+	a.free = stress_free;
+	a.ctx = ctx;
+	a.usable_size = hooks.usable_size ? stress_usable : NULL;
+	a.expand_in_place = hooks.expand ? stress_expand : NULL;
+	a.alloc_zeroed = hooks.zeroed ? stress_alloc_zeroed : NULL;
+	return (a);
+}
+
+/* ==================== */
+/* -- Shadow model   -- */
+/* ==================== */
+
+typedef struct {
+	Vector						v;
+	std::vector<unsigned char>	m;	// what v must hold, byte for byte
+	bool						live;
+} Slot;
+
+static void check_slot(const Slot &s)
+{
+	const Vector &v = s.v;
+
+	STRESS_CHECK(v.size * v.elem_size == s.m.size(), "size differs from the model");
+	STRESS_CHECK(v.size <= v.capacity, "size past capacity");
+	STRESS_CHECK(v.capacity == 0 || v.data != NULL, "capacity without data");
+	if (v.data && v.align)
+		STRESS_CHECK((uintptr_t)v.data % v.align == 0, "data misaligned");
+	if (v.size > 0)
+		STRESS_CHECK(memcmp(v.data, s.m.data(), s.m.size()) == 0, "contents differ from the model");
+}
+
+static void random_bytes(Rng &rng, std::vector<unsigned char> &buf, size_t n)
+{
+	buf.resize(n);
+	for (size_t i = 0; i < n; ++i)
+		buf[i] = (unsigned char)rng.next();
+}
+
+static VectorGrowth random_growth(Rng &rng)
+{
+	static const size_t	factors[][2] = { { 0, 0 }, { 3, 2 }, { 2, 1 }, { 5, 4 } };
+	VectorGrowth		g;
+	size_t				f = rng.below(4);
+
+	memset(&g, 0, sizeof(g));
+	g.initial = rng.below(3) == 0 ? 1 + rng.below(16) : 0;
+	g.factor_num = factors[f][0];
+	g.factor_den = factors[f][1];
+	if (rng.below(3) == 0)
+	{
+		g.round_threshold = 256;
+		g.round_to = rng.below(2) ? 0 : 64 << rng.below(4);
+	}
+	g.linear_cap = rng.below(4) == 0 ? 1 + rng.below(2048) : 0;
+	return (g);
+}
+
+/* ==================== */
+/* -- Random ops     -- */
+/* ==================== */
+
+enum StressOp
+{
+	OP_PUSH, OP_PUSH_N, OP_INSERT, OP_INSERT_N, OP_ERASE, OP_ERASE_RANGE, OP_POP,
+	OP_SWAP_POP, OP_RESERVE, OP_SHRINK, OP_CLEAR, OP_RESIZE, OP_RESIZE_UNINIT,
+	OP_RESIZE_FILL, OP_SPARE, OP_APPEND, OP_CLONE, OP_CLONE_SHARED, OP_WRITE_UNIQUE,
+	OP_GROWTH, OP_GROW, OP_DESTROY, OP_COUNT
+};
+
+static const char *stress_op_names[] = {
+	"push", "push_n", "insert", "insert_n", "erase", "erase_range", "pop",
+	"swap_pop", "reserve", "shrink_to_fit", "clear", "resize", "resize_uninit",
+	"resize_fill", "spare+commit", "append", "clone", "clone_shared", "make_unique+write",
+	"set_growth", "grow", "destroy"
+};
+
+/* Relative frequency of each op, destructive ones are rare so vectors get big. */
+static const unsigned stress_op_weights[OP_COUNT] = {
+	30, 8, 8, 4, 6, 3, 6, 5, 3, 2, 1, 3, 3, 3, 3, 2, 1, 2, 3, 1, 1, 1
+};
+
+typedef struct {
+	Rng							rng;
+	StressCtx					*ctx;
+	Allocator					alloc;
+	size_t						elem_size;
+	size_t						align;
+	Slot						slots[STRESS_SLOTS];
+	std::vector<unsigned char>	tmp;
+} Round;
+
+static StressOp pick_op(Rng &rng)
+{
+	unsigned total = 0;
+
+	for (int i = 0; i < OP_COUNT; ++i)
+		total += stress_op_weights[i];
+
+	unsigned r = (unsigned)rng.below(total);
+	int op = 0;
+	while (r >= stress_op_weights[op])
+		r -= stress_op_weights[op++];
+	return ((StressOp)op);
+}
+
+static void slot_init(Round &r, Slot &s)
+{
+	s.v = vector_init_aligned(r.alloc, r.elem_size, r.align);
+	s.m.clear();
+	s.live = true;
+}
+
+static void slot_destroy(Slot &s)
+{
+	if (s.live)
+		vector_destroy(&s.v);
+	s.m.clear();
+	s.live = false;
+}
+
+/*
+ * Runs op on slot si and mirrors it in the model when it succeeded. A failure
+ * is only allowed when the allocator refused something during the op, or the
+ * request itself is invalid (expected).
+*/
+static void run_random_op(Round &r, size_t si, StressOp op)
+{
+	Slot						&s = r.slots[si];
+	Vector						*v = &s.v;
+	std::vector<unsigned char>	&m = s.m;
+	std::vector<unsigned char>	&tmp = r.tmp;
+	size_t						es = r.elem_size;
+	size_t						size = v->size;
+	size_t						failures = r.ctx->failures;
+	bool						ok = true;
+	bool						expected = false;
+
+	g_op_name = stress_op_names[op];
+	switch (op)
+	{
+		case OP_PUSH:
+			random_bytes(r.rng, tmp, es);
+			if ((ok = vector_push(v, tmp.data())))
+				m.insert(m.end(), tmp.begin(), tmp.end());
+			break;
+		case OP_PUSH_N:
+		{
+			size_t k = r.rng.below(40);
+			random_bytes(r.rng, tmp, k * es);
+			if ((ok = vector_push_n(v, tmp.data(), k)))
+				m.insert(m.end(), tmp.begin(), tmp.end());
+			break;
+		}
+		case OP_INSERT:
+		{
+			size_t i = r.rng.below(size + 1);
+			random_bytes(r.rng, tmp, es);
+			if ((ok = vector_insert(v, i, tmp.data())))
+				m.insert(m.begin() + i * es, tmp.begin(), tmp.end());
+			break;
+		}
+		case OP_INSERT_N:
+		{
+			size_t i = r.rng.below(size + 1);
+			size_t k = r.rng.below(40);
+			random_bytes(r.rng, tmp, k * es);
+			if ((ok = vector_insert_n(v, i, tmp.data(), k)))
+				m.insert(m.begin() + i * es, tmp.begin(), tmp.end());
+			break;
+		}
+		case OP_ERASE:
+			if (size == 0)
+				break;
+			{
+				size_t i = r.rng.below(size);
+				if ((ok = vector_erase(v, i)))
+					m.erase(m.begin() + i * es, m.begin() + (i + 1) * es);
+			}
+			break;
+		case OP_ERASE_RANGE:
+		{
+			size_t first = r.rng.below(size + 1);
+			size_t last = first + r.rng.below(size - first + 1);
+			if ((ok = vector_erase_range(v, first, last)))
+				m.erase(m.begin() + first * es, m.begin() + last * es);
+			break;
+		}
+		case OP_POP:
+			expected = size == 0;
+			if ((ok = vector_pop(v)))
+				m.resize(m.size() - es);
+			break;
+		case OP_SWAP_POP:
+			if (size == 0)
+				break;
+			{
+				size_t i = r.rng.below(size);
+				if ((ok = vector_swap_pop(v, i)))
+				{
+					memmove(&m[i * es], &m[m.size() - es], es);
+					m.resize(m.size() - es);
+				}
+			}
+			break;
+		case OP_RESERVE:
+		{
+			size_t n = size + r.rng.below(200);
+			if (r.rng.below(8) == 0)
+				n = SIZE_MAX / es + 1;
+			expected = n > SIZE_MAX / es;
+			if ((ok = vector_reserve(v, n)))
+				STRESS_CHECK(v->capacity >= n, "reserve left capacity short");
+			break;
+		}
+		case OP_SHRINK:
+			if ((ok = vector_shrink_to_fit(v)) && size == 0)
+				STRESS_CHECK(v->capacity == 0 && v->data == NULL, "empty shrink kept its block");
+			break;
+		case OP_CLEAR:
+			vector_clear(v);
+			m.clear();
+			break;
+		case OP_RESIZE:
+		{
+			size_t n = r.rng.below(size * 2 + 20);
+			if ((ok = vector_resize(v, n)))
+				m.resize(n * es, 0);
+			break;
+		}
+		case OP_RESIZE_UNINIT:
+		{
+			size_t n = r.rng.below(size * 2 + 20);
+			if ((ok = vector_resize_uninit(v, n)))
+			{
+				m.resize(n * es);
+				if (n > size)
+				{
+					random_bytes(r.rng, tmp, (n - size) * es);
+					memcpy((char *)v->data + size * es, tmp.data(), tmp.size());
+					memcpy(&m[size * es], tmp.data(), tmp.size());
+				}
+			}
+			break;
+		}
+		case OP_RESIZE_FILL:
+		{
+			size_t n = r.rng.below(size * 2 + 20);
+			random_bytes(r.rng, tmp, es);
+			if ((ok = vector_resize_fill(v, n, tmp.data())))
+			{
+				m.resize(std::min(m.size(), n * es));
+				while (m.size() < n * es)
+					m.insert(m.end(), tmp.begin(), tmp.end());
+			}
+			break;
+		}
+		case OP_SPARE:
+		{
+			size_t	spare;
+			char	*p = (char *)vector_spare(v, &spare);
+			if ((ok = p != NULL))
+			{
+				STRESS_CHECK(spare > 0, "spare returned no room");
+				size_t k = 1 + r.rng.below(std::min(spare, (size_t)64));
+				random_bytes(r.rng, tmp, k * es);
+				memcpy(p, tmp.data(), tmp.size());
+				STRESS_CHECK(vector_commit(v, k), "commit within spare failed");
+				m.insert(m.end(), tmp.begin(), tmp.end());
+			}
+			break;
+		}
+		case OP_APPEND:
+		{
+			Slot &src = r.slots[r.rng.below(STRESS_SLOTS)];
+			if (!src.live)
+				break;
+			std::vector<unsigned char> add = src.m;	// src may be s itself
+			if ((ok = vector_append(v, &src.v)))
+				m.insert(m.end(), add.begin(), add.end());
+			break;
+		}
+		case OP_CLONE:
+		case OP_CLONE_SHARED:
+		{
+			Slot &dst = r.slots[(si + 1 + r.rng.below(STRESS_SLOTS - 1)) % STRESS_SLOTS];
+			slot_destroy(dst);
+			ok = op == OP_CLONE ? vector_clone(&dst.v, v) : vector_clone_shared(&dst.v, v);
+			if (ok)
+			{
+				dst.m = m;
+				dst.live = true;
+				check_slot(dst);
+			}
+			break;
+		}
+		case OP_WRITE_UNIQUE:
+			if (size == 0)
+				break;
+			if ((ok = vector_make_unique(v)))
+			{
+				size_t i = r.rng.below(size);
+				random_bytes(r.rng, tmp, es);
+				memcpy((char *)v->data + i * es, tmp.data(), es);
+				memcpy(&m[i * es], tmp.data(), es);
+			}
+			break;
+		case OP_GROWTH:
+			vector_set_growth(v, random_growth(r.rng));
+			break;
+		case OP_GROW:
+			ok = vector_grow(v);
+			break;
+		case OP_DESTROY:
+			slot_destroy(s);
+			slot_init(r, s);
+			break;
+		case OP_COUNT:
+			break;
+	}
+	STRESS_CHECK(ok || expected || r.ctx->failures != failures, "op failed without an allocation failure");
+	check_slot(s);
+}
+
+static const size_t	stress_elem_sizes[] = { 1, 2, 3, 8, 12, 24, 64 };
+static const size_t	stress_aligns[] = { 0, 0, 0, 8, 16, 64, 256 };
+static const unsigned	stress_fail_rates[] = { 0, 0, 5, 50, 300 };
+
+/* One allocator and element configuration, STRESS_ROUND_OPS random ops on it. */
+static size_t run_round(Rng &rng, size_t ops)
+{
+	StressCtx	ctx;
+	StressHooks	hooks;
+	Round		r;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.rng.s = rng.next() | 1;
+	ctx.fail_per_mille = stress_fail_rates[rng.below(5)];
+	ctx.mode = (AlignMode)rng.below(3);
+	ctx.slack = rng.below(2);
+	hooks.realloc = rng.below(3) != 0;
+	hooks.usable_size = rng.below(2);
+	hooks.expand = rng.below(2);
+	hooks.zeroed = rng.below(2);
+
+	r.rng.s = rng.next() | 1;
+	r.ctx = &ctx;
+	r.alloc = stress_allocator(&ctx, hooks);
+	r.elem_size = stress_elem_sizes[rng.below(7)];
+	r.align = stress_aligns[rng.below(7)];
+	for (size_t i = 0; i < STRESS_SLOTS; ++i)
+		slot_init(r, r.slots[i]);
+
+	for (size_t i = 0; i < ops; ++i, ++g_op_index)
+	{
+		size_t si = r.rng.below(STRESS_SLOTS);
+		if (!r.slots[si].live)
+			slot_init(r, r.slots[si]);
+		run_random_op(r, si, pick_op(r.rng));
+		// Clones share buffers, a write through one must never show in another
+		if (i % 64 == 0)
+		{
+			for (size_t j = 0; j < STRESS_SLOTS; ++j)
+			{
+				if (r.slots[j].live)
+					check_slot(r.slots[j]);
+			}
+		}
+		// Mostly tiny vectors catch more edge cases than a few huge ones
+		if (r.slots[si].v.size > 4096)
+		{
+			slot_destroy(r.slots[si]);
+			slot_init(r, r.slots[si]);
+		}
+	}
+
+	g_op_name = "round teardown";
+	for (size_t i = 0; i < STRESS_SLOTS; ++i)
+	{
+		if (r.slots[i].live)
+			check_slot(r.slots[i]);
+		slot_destroy(r.slots[i]);
+	}
+	STRESS_CHECK(ctx.live == 0, "blocks leaked after destroying every vector");
+	return (ctx.failures);
+}
+
+/* ==================== */
+/* -- Edge cases     -- */
+/* ==================== */
+
+/* The fiddly branches, hit on purpose instead of hoping the dice find them. */
+static void run_edge_cases(void)
+{
+	StressCtx		ctx;
+	StressHooks		hooks = { true, true, false, false };
+	char			byte = 1;
+	unsigned char	elems[8 * 64] = { 0 };
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.rng.s = g_seed | 1;
+	Allocator alloc = stress_allocator(&ctx, hooks);
+
+	// Shrinking an empty vector gives the block back
+	g_op_name = "edge: shrink empty";
+	Vector v = vector_init(alloc, 4);
+	STRESS_CHECK(vector_reserve(&v, 100), "reserve failed");
+	STRESS_CHECK(vector_shrink_to_fit(&v), "shrink failed");
+	STRESS_CHECK(v.capacity == 0 && v.data == NULL && ctx.live == 0, "empty shrink kept its block");
+
+	// Both sides of a shared empty buffer shrink and free exactly once
+	g_op_name = "edge: shrink shared empty";
+	Vector w;
+	STRESS_CHECK(vector_reserve(&v, 10) && vector_clone_shared(&w, &v), "clone_shared failed");
+	STRESS_CHECK(vector_shrink_to_fit(&v) && vector_shrink_to_fit(&w), "shrink failed");
+	vector_destroy(&v);
+	vector_destroy(&w);
+	STRESS_CHECK(ctx.live == 0, "shared shrink leaked");
+
+	// Size overflow is refused before anything is allocated
+	g_op_name = "edge: overflow";
+	v = vector_init(alloc, 8);
+	vector_push(&v, elems);
+	size_t calls = ctx.calls;
+	STRESS_CHECK(!vector_reserve(&v, SIZE_MAX / 8 + 1), "overflowing reserve succeeded");
+	STRESS_CHECK(!vector_push_n(&v, elems, SIZE_MAX), "overflowing push_n succeeded");
+	STRESS_CHECK(!vector_insert_n(&v, 0, elems, SIZE_MAX), "overflowing insert_n succeeded");
+	STRESS_CHECK(ctx.calls == calls && v.size == 1, "overflow touched the vector");
+
+	// A growth policy that overflows fails the push cleanly
+	g_op_name = "edge: huge growth";
+	VectorGrowth g;
+	memset(&g, 0, sizeof(g));
+	g.initial = SIZE_MAX - 1;
+	Vector h = vector_init(alloc, 1);
+	vector_set_growth(&h, g);
+	STRESS_CHECK(!vector_push(&h, &byte) && h.size == 0 && h.data == NULL, "huge first grow");
+	vector_destroy(&h);
+
+	// grow_vector's SIZE_MAX clamp: a full vector with capacity SIZE_MAX
+	g_op_name = "edge: SIZE_MAX capacity";
+	h = vector_init_buffer(alloc, 1, &byte, 1);
+	h.capacity = SIZE_MAX;
+	h.size = SIZE_MAX;
+	calls = ctx.calls;
+	STRESS_CHECK(!vector_push(&h, &byte) && !vector_grow(&h), "grew past SIZE_MAX");
+	STRESS_CHECK(!vector_push_n(&h, &byte, 1), "push_n past SIZE_MAX");
+	STRESS_CHECK(ctx.calls == calls, "SIZE_MAX clamp reached the allocator");
+	h.size = 0;
+	h.capacity = 1;
+	vector_destroy(&h);
+
+	// Every op that needs memory fails and leaves the contents alone
+	g_op_name = "edge: allocator down";
+	Slot s;
+	s.v = v;
+	s.m.assign((char *)v.data, (char *)v.data + 8);
+	s.live = true;
+	ctx.fail_per_mille = 1000;
+	STRESS_CHECK(!vector_push_n(&s.v, elems, 64) && !vector_insert_n(&s.v, 0, elems, 64)
+		&& !vector_resize(&s.v, 64) && !vector_reserve(&s.v, 64), "grew with a dead allocator");
+	STRESS_CHECK(!vector_shrink_to_fit(&s.v), "shrank with a dead allocator");
+	check_slot(s);
+	ctx.fail_per_mille = 0;
+	STRESS_CHECK(vector_push_n(&s.v, elems, 64), "push_n failed after recovery");
+	s.m.insert(s.m.end(), elems, elems + sizeof(elems));
+	check_slot(s);
+	slot_destroy(s);
+	STRESS_CHECK(ctx.live == 0, "edge cases leaked");
+}
+
+#if defined(BENCH_WITH_ARENA) && defined(VECTOR_ARENA_IS_LAST) && defined(VECTOR_ARENA_MARK)
+/*
+ * Destroying a vector rewinds the arena only when its buffer is the last
+ * allocation; any other destroy must leave the arena as it is, so the
+ * rewinds after it still line up.
+*/
+static void run_arena_cases(void)
+{
+	Arena				arena = arena_init(PROT_READ | PROT_WRITE);
+	Allocator			alloc = arena_allocator(&arena);
+	Vector				v[3];
+	VECTOR_ARENA_MARK_T	marks[3];
+	int					x = 7;
+
+	// LIFO: the newest buffer goes back, the ones below never grow the arena
+	g_op_name = "arena: LIFO destroy";
+	for (int i = 0; i < 3; ++i)
+	{
+		marks[i] = VECTOR_ARENA_MARK(&arena);
+		v[i] = vector_init(alloc, sizeof(int));
+		STRESS_CHECK(vector_reserve(&v[i], 64) && vector_push(&v[i], &x), "arena reserve failed");
+	}
+	for (int i = 2; i >= 0; --i)
+	{
+		vector_destroy(&v[i]);
+		STRESS_CHECK(VECTOR_ARENA_MARK(&arena) <= marks[2], "destroy grew the arena");
+		if (i == 2)
+			STRESS_CHECK(VECTOR_ARENA_MARK(&arena) == marks[2], "tail destroy didn't rewind");
+	}
+
+	// Creation order: the older buffers stay put, the tail still rewinds
+	g_op_name = "arena: creation-order destroy";
+	for (int i = 0; i < 3; ++i)
+	{
+		marks[i] = VECTOR_ARENA_MARK(&arena);
+		v[i] = vector_init(alloc, sizeof(int));
+		STRESS_CHECK(vector_reserve(&v[i], 64) && vector_push(&v[i], &x), "arena reserve failed");
+	}
+	VECTOR_ARENA_MARK_T top = VECTOR_ARENA_MARK(&arena);
+	void *tail = v[2].data;
+	for (int i = 0; i < 2; ++i)
+	{
+		vector_destroy(&v[i]);
+		STRESS_CHECK(VECTOR_ARENA_MARK(&arena) == top, "non-tail destroy touched the arena");
+	}
+	vector_destroy(&v[2]);
+	STRESS_CHECK(VECTOR_ARENA_MARK(&arena) == marks[2], "tail destroy didn't rewind");
+
+	// The next vector reuses the rewound space and rewinds again
+	Vector w = vector_init(alloc, sizeof(int));
+	STRESS_CHECK(vector_reserve(&w, 64) && w.data == tail, "rewound space not reused");
+	vector_destroy(&w);
+	STRESS_CHECK(VECTOR_ARENA_MARK(&arena) == marks[2], "second rewind failed");
+	BENCH_ARENA_DESTROY(&arena);
+}
+#endif
+
+/* ==================== */
+/* -- Throughput     -- */
+/* ==================== */
+
+/*
+ * A fixed mix of the hot ops on malloc_allocator, timed in STRESS_WINDOWS
+ * windows. Returns the median ops/s, so one noisy window can't fail the gate.
+*/
+static double measure_throughput(size_t ops)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	Rng					rng = { 0x9e3779b97f4a7c15ULL };
+	Vector				v = vector_init(malloc_allocator(), 16);
+	unsigned char		elem[16 * 8] = { 0 };
+	size_t				window = ops / STRESS_WINDOWS ? ops / STRESS_WINDOWS : 1;
+	std::vector<double>	rates;
+
+	g_op_name = "throughput";
+	for (size_t w = 0; w < STRESS_WINDOWS; ++w)
+	{
+		Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < window; ++i)
+		{
+			size_t r = rng.below(16);
+			elem[0] = (unsigned char)i;
+			if (r < 8)
+				vector_push(&v, elem);
+			else if (r < 10)
+				vector_push_n(&v, elem, 8);
+			else if (r < 13 && v.size > 0)
+				vector_pop(&v);
+			else if (r < 15 && v.size > 0)
+				vector_swap_pop(&v, rng.below(v.size));
+			else if (v.size > 1 << 16)
+				vector_resize(&v, v.size / 2);
+		}
+		double secs = std::chrono::duration<double>(Clock::now() - start).count();
+		rates.push_back((double)window / (secs > 0 ? secs : 1e-9));
+		printf("window %2zu %14.0f ops/s\n", w, rates.back());
+	}
+	vector_destroy(&v);
+	std::sort(rates.begin(), rates.end());
+	return (rates[rates.size() / 2]);
+}
+
+int main(int argc, char **argv)
+{
+	size_t		ops = 2000000;
+	const char	*write_path = NULL;
+	const char	*baseline_path = NULL;
+	double		threshold = 0.8;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-n") == 0)
+			ops = (size_t)strtoull(argv[i + 1], NULL, 10);
+		else if (strcmp(argv[i], "-s") == 0)
+			g_seed = strtoull(argv[i + 1], NULL, 10);
+		else if (strcmp(argv[i], "-w") == 0)
+			write_path = argv[i + 1];
+		else if (strcmp(argv[i], "-b") == 0)
+			baseline_path = argv[i + 1];
+		else if (strcmp(argv[i], "-t") == 0)
+			threshold = strtod(argv[i + 1], NULL);
+		else
+		{
+			fprintf(stderr, "usage: %s [-n ops] [-s seed] [-w file] [-b file] [-t ratio]\n", argv[0]);
+			return (1);
+		}
+	}
+
+	run_edge_cases();
+#if defined(BENCH_WITH_ARENA) && defined(VECTOR_ARENA_IS_LAST) && defined(VECTOR_ARENA_MARK)
+	run_arena_cases();
+#endif
+
+	Rng		rng = { g_seed * 0x2545f4914f6cdd1dULL | 1 };
+	size_t	rounds = 0;
+	size_t	injected = 0;
+	for (size_t done = 0; done < ops; done += STRESS_ROUND_OPS, ++rounds)
+		injected += run_round(rng, std::min((size_t)STRESS_ROUND_OPS, ops - done));
+	printf("ok: %zu ops in %zu rounds, %zu allocation failures injected, seed %llu\n",
+		ops, rounds, injected, g_seed);
+
+	double rate = measure_throughput(ops);
+	printf("throughput %.0f ops/s (median)\n", rate);
+
+	if (write_path)
+	{
+		FILE *f = fopen(write_path, "w");
+		if (!f || fprintf(f, "%.0f\n", rate) < 0 || fclose(f) != 0)
+		{
+			fprintf(stderr, "could not write %s\n", write_path);
+			return (1);
+		}
+	}
+	if (baseline_path)
+	{
+		FILE	*f = fopen(baseline_path, "r");
+		double	baseline = 0;
+		if (!f || fscanf(f, "%lf", &baseline) != 1)
+		{
+			fprintf(stderr, "could not read a baseline from %s\n", baseline_path);
+			return (1);
+		}
+		fclose(f);
+		printf("baseline %.0f ops/s, ratio %.2f (threshold %.2f)\n", baseline, rate / baseline, threshold);
+		if (rate < threshold * baseline)
+		{
+			fprintf(stderr, "FAIL throughput regressed below %.0f%% of the baseline\n", threshold * 100);
+			return (2);
+		}
+	}
+	return (0);
+}
@@ -1,6 +1,6 @@
 /*
    -----------------------------------------------------------------------------
-   VECTOR.H v1.0.0
+   VECTOR.H v2.0.0
    -----------------------------------------------------------------------------
    Memory-agnostic growable array implementation.
    
@@ -16,6 +16,10 @@
      #include "vector.h"
 
 	 In all other files, just #include "vector.h" as per normal.
+
+	 v2.0.0: Allocator grew the optional usable_size, expand_in_place and
+	 alloc_zeroed callbacks. Build custom allocators with allocator_make,
+	 which sets those to NULL, instead of assigning the fields one by one.
 */
 
 #ifndef VECTOR_H
@@ -28,6 +32,10 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#if defined(__GLIBC__)
+# include <malloc.h>
+#endif
+
 #ifndef GROWTH_FACTOR
 # define GROWTH_FACTOR (2)
 #endif
@@ -35,14 +43,49 @@
 typedef void *(*alloc_fn)(void *ctx, size_t size, size_t align);
 typedef void (*free_fn)(void *ctx, void *ptr);
 typedef void *(*realloc_fn)(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align);
+/* Optional: bytes actually usable in a block that was allocated with size bytes. */
+typedef size_t (*usable_size_fn)(void *ctx, void *ptr, size_t size);
+/* Optional: grow the block at ptr to new_size without moving it, false if it can't. */
+typedef bool (*expand_fn)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+/* Optional: like alloc, but the block reads as zero (e.g. calloc or fresh mmap pages). */
+typedef void *(*alloc_zeroed_fn)(void *ctx, size_t size, size_t align);
 
 typedef struct {
-	alloc_fn	alloc;
-	realloc_fn	realloc;
-	free_fn		free;
-	void		*ctx;
+	alloc_fn		alloc;
+	realloc_fn		realloc;
+	free_fn			free;
+	void			*ctx;
+	usable_size_fn	usable_size;
+	expand_fn		expand_in_place;
+	alloc_zeroed_fn	alloc_zeroed;
 } Allocator;
 
+/*
+ * Per-vector growth policy, set with vector_set_growth. Zeroed fields keep
+ * the defaults: first capacity of 8, multiplied by GROWTH_FACTOR per grow.
+ * 		initial:			first capacity in elements
+ * 		factor_num/den:		growth factor, e.g. 3 / 2 for 1.5x
+ * 		round_threshold:	allocations of at least this many bytes are
+ * 							rounded up to a multiple of round_to (e.g. the
+ * 							page size), or to size classes if round_to is 0
+ * 		linear_cap:			max bytes added by a single grow
+ * 		max_capacity:		hard cap in elements; growth stops there, and
+ * 							anything that needs more returns false
+*/
+typedef struct {
+	size_t	initial;
+	size_t	factor_num;
+	size_t	factor_den;
+	size_t	round_threshold;
+	size_t	round_to;
+	size_t	linear_cap;
+	size_t	max_capacity;
+} VectorGrowth;
+
+/* Vector flags */
+#define VECTOR_INLINE	(1u << 0)	// data is a caller-provided buffer, not owned
+#define VECTOR_FIXED	(1u << 1)	// never grows, see vector_init_static
+
 typedef struct {
 	size_t			size;
 	size_t			capacity;
@@ -50,29 +93,102 @@ typedef struct {
 	size_t			align;
 	void			*data;
 	Allocator	alloc;
+	VectorGrowth	growth;
+	unsigned int	flags;
+	size_t			*refs;	// shared buffer refcount (malloc'd), NULL unless shared by vector_clone_shared
 } Vector;
 
+/*
+ * Allocation and growth counters, only collected when VECTOR_STATS is
+ * defined (in every file that includes vector.h). Otherwise the counting
+ * compiles away entirely. Fill ratio of destroyed vectors is
+ * destroyed_size_bytes / destroyed_capacity_bytes.
+*/
+typedef struct {
+	size_t	grows;
+	size_t	allocs;
+	size_t	reallocs;
+	size_t	expands_in_place;
+	size_t	bytes_copied;
+	size_t	peak_capacity_bytes;
+	size_t	destroyed;
+	size_t	destroyed_size_bytes;
+	size_t	destroyed_capacity_bytes;
+} VectorStats;
+
+/* Called from vector_destroy with the vector still intact. */
+typedef void (*vector_stats_fn)(const Vector *v, void *user);
+
 /* ================================== */
 /* -- Allocator pattern for malloc -- */ 
 /* ================================== */
+
+/*
+ * Alignment malloc/realloc already guarantee. Requests up to this go straight
+ * to malloc/realloc, anything stricter goes through aligned_alloc.
+*/
+#ifndef VECTOR_MALLOC_ALIGN
+# define VECTOR_MALLOC_ALIGN (2 * sizeof(void *))
+#endif
+
+static void *malloc_aligned_block(size_t size, size_t align)
+{
+	if (align < sizeof(void *))
+		align = sizeof(void *);
+
+	// aligned_alloc requires size to be a multiple of align
+	size_t rounded = (size + align - 1) & ~(align - 1);
+	if (rounded < size)
+		return (NULL);
+	return (aligned_alloc(align, rounded));
+}
+
 static void *malloc_alloc(void *ctx, size_t size, size_t align)
 {
 	(void)ctx;
 
-	if (align > 0)
-	{
-		assert(0 && "malloc does not support alignment");
-		return (NULL);
-	}
+	if (align > VECTOR_MALLOC_ALIGN)
+		return (malloc_aligned_block(size, align));
 	return (malloc(size));
 }
 
+/*
+ * realloc only guarantees VECTOR_MALLOC_ALIGN, so stricter alignments are
+ * reallocated by hand: allocate an aligned block, copy, free the old one.
+*/
 static void *malloc_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align)
 {
 	(void)ctx;
-	(void)old_size;
-	(void)align;
-	return (realloc(ptr, new_size));
+
+	if (align <= VECTOR_MALLOC_ALIGN)
+		return (realloc(ptr, new_size));
+
+	void *new_block = malloc_aligned_block(new_size, align);
+	if (!new_block)
+		return (NULL);
+	if (ptr)
+	{
+		memcpy(new_block, ptr, old_size < new_size ? old_size : new_size);
+		free(ptr);
+	}
+	return (new_block);
+}
+
+/*
+ * calloc hands large blocks straight from fresh mmap pages, which are already
+ * zero, so big zeroed allocations don't touch memory until it's used.
+*/
+static void *malloc_alloc_zeroed(void *ctx, size_t size, size_t align)
+{
+	(void)ctx;
+
+	if (align <= VECTOR_MALLOC_ALIGN)
+		return (calloc(1, size));
+
+	void *p = malloc_aligned_block(size, align);
+	if (p)
+		memset(p, 0, size);
+	return (p);
 }
 
 static void malloc_free(void *ctx, void *ptr)
@@ -81,14 +197,43 @@ static void malloc_free(void *ctx, void *ptr)
 	free(ptr);
 }
 
-static Allocator malloc_allocator(void)
+#if defined(__GLIBC__)
+/* Size-class slack glibc rounded the block up to, usable without a realloc. */
+static size_t malloc_usable(void *ctx, void *ptr, size_t size)
+{
+	(void)ctx;
+	(void)size;
+	return (malloc_usable_size(ptr));
+}
+#endif
+
+/*
+ * Allocator with the required callbacks and every optional one NULL, so
+ * code written before the optional ones existed keeps working. realloc and
+ * free may be NULL too. Set the optional fields on the result as needed.
+*/
+static Allocator allocator_make(alloc_fn alloc_cb, realloc_fn realloc_cb, free_fn free_cb, void *ctx)
 {
 	Allocator a;
 
-	a.alloc = malloc_alloc;
-	a.realloc = malloc_realloc;
-	a.free = malloc_free;
-	a.ctx = NULL;
+	a.alloc = alloc_cb;
+	a.realloc = realloc_cb;
+	a.free = free_cb;
+	a.ctx = ctx;
+	a.usable_size = NULL;
+	a.expand_in_place = NULL;
+	a.alloc_zeroed = NULL;
+	return (a);
+}
+
+static Allocator malloc_allocator(void)
+{
+	Allocator a = allocator_make(malloc_alloc, malloc_realloc, malloc_free, NULL);
+
+#if defined(__GLIBC__)
+	a.usable_size = malloc_usable;
+#endif
+	a.alloc_zeroed = malloc_alloc_zeroed;
 	return (a);
 }
 
@@ -99,6 +244,8 @@ static Allocator malloc_allocator(void)
 // Initialization
 Vector	vector_init(Allocator alloc, size_t elem_size);
 Vector	vector_init_aligned(Allocator alloc, size_t elem_size, size_t align);
+Vector	vector_init_buffer(Allocator alloc, size_t elem_size, void *buf, size_t capacity);
+Vector	vector_init_static(void *buf, size_t capacity, size_t elem_size);
 
 // Modifiers
 bool	vector_reserve(Vector *v, size_t new_capacity);
@@ -110,6 +257,35 @@ bool	vector_erase(Vector *v, size_t index);
 bool	vector_pop(Vector *v);
 bool	vector_swap_pop(Vector *v, size_t index);
 bool	vector_shrink_to_fit(Vector *v);
+bool	vector_grow(Vector *v);
+void	vector_set_growth(Vector *v, VectorGrowth growth);
+
+// Bulk modifiers
+bool	vector_push_n(Vector *v, const void *src, size_t count);
+bool	vector_insert_n(Vector *v, size_t index, const void *src, size_t count);
+bool	vector_erase_range(Vector *v, size_t first, size_t last);
+bool	vector_append(Vector *dst, const Vector *src);
+
+// Cloning
+bool	vector_clone(Vector *dst, const Vector *src);
+bool	vector_clone_shared(Vector *dst, Vector *src);
+bool	vector_make_unique(Vector *v);
+
+// Resizing
+bool	vector_resize(Vector *v, size_t new_size);
+bool	vector_resize_uninit(Vector *v, size_t new_size);
+bool	vector_resize_fill(Vector *v, size_t new_size, const void *value);
+
+// Writing into spare capacity
+void	*vector_spare(Vector *v, size_t *count);
+bool	vector_commit(Vector *v, size_t count);
+
+#ifdef VECTOR_STATS
+// Instrumentation
+VectorStats	vector_stats(void);
+void		vector_stats_reset(void);
+void		vector_set_stats_hook(vector_stats_fn fn, void *user);
+#endif
 
 /* ==================== */
 /* -- Helper macros  -- */
@@ -145,12 +321,306 @@ bool	vector_shrink_to_fit(Vector *v);
 /* Vector v = vector_init_malloc(int); */
 #define vector_init_malloc(T) vector_init(malloc_allocator(), sizeof(T))
 
+/* int buf[16]; Vector v = vector_init_stack(malloc_allocator(), buf); */
+#define vector_init_stack(alloc, buf) \
+	vector_init_buffer((alloc), sizeof((buf)[0]), (buf), sizeof(buf) / sizeof((buf)[0]))
+
+/* static Sample buf[256]; Vector v = vector_init_static_array(buf); */
+#define vector_init_static_array(buf) \
+	vector_init_static((buf), sizeof(buf) / sizeof((buf)[0]), sizeof((buf)[0]))
+
+/* Vector v = vector_init_aligned_malloc(float, 32); */
+#define vector_init_aligned_malloc(T, align) vector_init_aligned(malloc_allocator(), sizeof(T), (align))
+
+/* ========================== */
+/* -- Block iteration      -- */
+/* ========================== */
+
+/* for (vector_foreach(&v, float, p)) *p *= 2.0f; -- pointer walk, no per-element assert */
+#define vector_foreach(v, T, p) \
+	T *p = (assert(sizeof(T) == (v)->elem_size && "element type mismatch"), (T *)(v)->data), \
+	*p##_end = p ? p + (v)->size : p; p < p##_end; ++p
+
+#ifndef VECTOR_BLOCK_BYTES
+# define VECTOR_BLOCK_BYTES	4096	// default block for vector_blocks, one page
+#endif
+
+#ifndef VECTOR_CACHE_LINE
+# define VECTOR_CACHE_LINE	64
+#endif
+
+#if defined(__GNUC__)
+# define VECTOR_PREFETCH(addr) __builtin_prefetch((addr), 0, 3)
+#else
+# define VECTOR_PREFETCH(addr) ((void)(addr))
+#endif
+
+/*
+ * Walks a vector's data in blocks of whole elements, handing out a raw
+ * pointer and count per block for the caller's own (SIMD) loop. Handing out
+ * a block prefetches the one after it, and in debug builds checks once that
+ * the vector wasn't resized or moved since vector_blocks.
+ * 		VectorBlocks it = vector_blocks(&v, 0);		// 0 = VECTOR_BLOCK_BYTES
+ * 		size_t n;
+ * 		for (float *p; (p = vector_next_block(&it, &n)); )
+ * 			scale(p, n);
+*/
+typedef struct {
+	const Vector	*v;
+	void			*data;		// v->data and v->size when the walk started
+	size_t			size;
+	char			*cur;
+	char			*end;
+	size_t			block_bytes;
+} VectorBlocks;
+
+static inline VectorBlocks vector_blocks(const Vector *v, size_t block_bytes)
+{
+	assert(v != NULL && v->size <= v->capacity && v->elem_size > 0 && "invalid vector");
+
+	VectorBlocks	it;
+	size_t			per_block = (block_bytes ? block_bytes : VECTOR_BLOCK_BYTES) / v->elem_size;
+
+	it.v = v;
+	it.data = v->data;
+	it.size = v->size;
+	it.cur = (char *)v->data;
+	it.end = v->size ? it.cur + v->size * v->elem_size : it.cur;
+	it.block_bytes = (per_block ? per_block : 1) * v->elem_size;
+	return (it);
+}
+
+/* Next block and its element count, or NULL once the whole vector was handed out. */
+static inline void *vector_next_block(VectorBlocks *it, size_t *count)
+{
+	assert(it->v->data == it->data && it->v->size == it->size
+		&& "vector changed during block iteration");
+
+	char	*block = it->cur;
+	size_t	left = (size_t)(it->end - block);
+	size_t	bytes = left < it->block_bytes ? left : it->block_bytes;
+
+	*count = bytes / it->v->elem_size;
+	if (bytes == 0)
+		return (NULL);
+	it->cur = block + bytes;
+
+	char *ahead_end = left - bytes < it->block_bytes ? it->end : it->cur + it->block_bytes;
+	for (char *line = it->cur; line < ahead_end; line += VECTOR_CACHE_LINE)
+		VECTOR_PREFETCH(line);
+	return (block);
+}
+
+/* ========================== */
+/* -- Typed vector family  -- */
+/* ========================== */
+
+/*
+ * VECTOR_DEFINE(int, IntVec) generates an IntVec type and static inline
+ * IntVec_* functions where sizeof(int) is a compile-time constant, so pushes
+ * and accesses become plain stores and loads instead of runtime-sized memcpy.
+ * 		Note: IntVec wraps a regular Vector (iv.vec), so it takes the same
+ * 		Allocator and can be passed to any vector_* function.
+ *
+ * 		VECTOR_DEFINE(int, IntVec)
+ * 		IntVec iv = IntVec_init(malloc_allocator());
+ * 		IntVec_push(&iv, 42);
+ * 		int x = IntVec_at(&iv, 0);
+*/
+#define VECTOR_DEFINE(T, Name) \
+	typedef struct { \
+		Vector	vec; \
+	} Name; \
+	\
+	static inline Name Name##_init(Allocator alloc) \
+	{ \
+		Name tv; \
+		tv.vec = vector_init(alloc, sizeof(T)); \
+		return (tv); \
+	} \
+	\
+	static inline Name Name##_init_buffer(Allocator alloc, T *buf, size_t capacity) \
+	{ \
+		Name tv; \
+		tv.vec = vector_init_buffer(alloc, sizeof(T), buf, capacity); \
+		return (tv); \
+	} \
+	\
+	static inline Name Name##_init_static(T *buf, size_t capacity) \
+	{ \
+		Name tv; \
+		tv.vec = vector_init_static(buf, capacity, sizeof(T)); \
+		return (tv); \
+	} \
+	\
+	static inline T *Name##_data(Name *tv) \
+	{ \
+		return ((T *)tv->vec.data); \
+	} \
+	\
+	static inline size_t Name##_size(const Name *tv) \
+	{ \
+		return (tv->vec.size); \
+	} \
+	\
+	static inline T Name##_at(Name *tv, size_t index) \
+	{ \
+		assert(index < tv->vec.size && "index out of bounds"); \
+		return (((T *)tv->vec.data)[index]); \
+	} \
+	\
+	static inline T Name##_front(Name *tv) \
+	{ \
+		assert(tv->vec.size > 0 && "vector empty"); \
+		return (((T *)tv->vec.data)[0]); \
+	} \
+	\
+	static inline T Name##_back(Name *tv) \
+	{ \
+		assert(tv->vec.size > 0 && "vector empty"); \
+		return (((T *)tv->vec.data)[tv->vec.size - 1]); \
+	} \
+	\
+	static inline bool Name##_reserve(Name *tv, size_t new_capacity) \
+	{ \
+		return (vector_reserve(&tv->vec, new_capacity)); \
+	} \
+	\
+	static inline bool Name##_push(Name *tv, T value) \
+	{ \
+		if (tv->vec.size == tv->vec.capacity ? !vector_grow(&tv->vec) \
+			: (tv->vec.refs && !vector_make_unique(&tv->vec))) \
+			return (false); \
+		((T *)tv->vec.data)[tv->vec.size++] = value; \
+		return (true); \
+	} \
+	\
+	/* Push for a vector that must not grow (e.g. _init_static): one compare, no calls. */ \
+	static inline bool Name##_push_fixed(Name *tv, T value) \
+	{ \
+		assert(!tv->vec.refs && "push_fixed on a shared vector"); \
+		if (tv->vec.size == tv->vec.capacity) \
+			return (false); \
+		((T *)tv->vec.data)[tv->vec.size++] = value; \
+		return (true); \
+	} \
+	\
+	static inline bool Name##_insert(Name *tv, size_t index, T value) \
+	{ \
+		assert(index <= tv->vec.size && "index out of bounds"); \
+		if (index > tv->vec.size) \
+			return (false); \
+		if (tv->vec.size == tv->vec.capacity ? !vector_grow(&tv->vec) \
+			: (tv->vec.refs && !vector_make_unique(&tv->vec))) \
+			return (false); \
+		T *data = (T *)tv->vec.data; \
+		memmove(data + index + 1, data + index, (tv->vec.size - index) * sizeof(T)); \
+		data[index] = value; \
+		tv->vec.size++; \
+		return (true); \
+	} \
+	\
+	static inline bool Name##_erase(Name *tv, size_t index) \
+	{ \
+		assert(index < tv->vec.size && "index out of bounds"); \
+		if (index >= tv->vec.size || !vector_make_unique(&tv->vec)) \
+			return (false); \
+		T *data = (T *)tv->vec.data; \
+		memmove(data + index, data + index + 1, (tv->vec.size - index - 1) * sizeof(T)); \
+		tv->vec.size--; \
+		return (true); \
+	} \
+	\
+	static inline bool Name##_pop(Name *tv) \
+	{ \
+		assert(tv->vec.size > 0 && "vector is empty"); \
+		if (tv->vec.size == 0) \
+			return (false); \
+		tv->vec.size--; \
+		return (true); \
+	} \
+	\
+	static inline bool Name##_swap_pop(Name *tv, size_t index) \
+	{ \
+		assert(index < tv->vec.size && "index out of bounds"); \
+		if (index >= tv->vec.size || !vector_make_unique(&tv->vec)) \
+			return (false); \
+		T *data = (T *)tv->vec.data; \
+		data[index] = data[tv->vec.size - 1]; \
+		tv->vec.size--; \
+		return (true); \
+	} \
+	\
+	static inline bool Name##_shrink_to_fit(Name *tv) \
+	{ \
+		return (vector_shrink_to_fit(&tv->vec)); \
+	} \
+	\
+	static inline void Name##_clear(Name *tv) \
+	{ \
+		vector_clear(&tv->vec); \
+	} \
+	\
+	static inline void Name##_destroy(Name *tv) \
+	{ \
+		vector_destroy(&tv->vec); \
+	}
+
 #endif // VECTOR_H
 
 #ifdef VECTOR_IMPLEMENTATION
 #ifndef VECTOR_IMPLEMENTATION_GUARD
 #define VECTOR_IMPLEMENTATION_GUARD
 
+/* ===================== */
+/* -- Instrumentation -- */
+/* ===================== */
+#ifdef VECTOR_STATS
+static VectorStats		g_vector_stats;
+static vector_stats_fn	g_vector_stats_hook;
+static void				*g_vector_stats_user;
+
+# if defined(__GNUC__)
+#  define VECTOR_STAT_ADD(field, n) \
+	__atomic_fetch_add(&g_vector_stats.field, (size_t)(n), __ATOMIC_RELAXED)
+# else
+#  define VECTOR_STAT_ADD(field, n) (g_vector_stats.field += (size_t)(n))
+# endif
+
+static void vector_stat_peak(size_t bytes)
+{
+# if defined(__GNUC__)
+	size_t peak = __atomic_load_n(&g_vector_stats.peak_capacity_bytes, __ATOMIC_RELAXED);
+	while (bytes > peak && !__atomic_compare_exchange_n(&g_vector_stats.peak_capacity_bytes,
+		&peak, bytes, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+# else
+	if (bytes > g_vector_stats.peak_capacity_bytes)
+		g_vector_stats.peak_capacity_bytes = bytes;
+# endif
+}
+# define VECTOR_STAT_PEAK(bytes) vector_stat_peak(bytes)
+
+VectorStats vector_stats(void)
+{
+	return (g_vector_stats);
+}
+
+void vector_stats_reset(void)
+{
+	memset(&g_vector_stats, 0, sizeof(g_vector_stats));
+}
+
+void vector_set_stats_hook(vector_stats_fn fn, void *user)
+{
+	g_vector_stats_hook = fn;
+	g_vector_stats_user = user;
+}
+#else
+# define VECTOR_STAT_ADD(field, n) ((void)0)
+# define VECTOR_STAT_PEAK(bytes) ((void)0)
+#endif
+
 /* ===================== */
 /* -- Internal checks -- */
 /* ===================== */
@@ -190,13 +660,153 @@ Vector vector_init_aligned(Allocator alloc, size_t elem_size, size_t align)
 	v.align = align;
 	v.data = NULL;
 	v.alloc = alloc;
+	memset(&v.growth, 0, sizeof(v.growth));
+	v.flags = 0;
+	v.refs = NULL;
+	return (v);
+}
+
+/*
+ * Small-buffer vector: the first capacity elements live in buf (e.g. a stack
+ * array) and the allocator is only called once they overflow, at which point
+ * the contents are copied out to the heap. buf is never freed by the vector.
+*/
+Vector vector_init_buffer(Allocator alloc, size_t elem_size, void *buf, size_t capacity)
+{
+	assert((buf != NULL || capacity == 0) && "buffer is NULL");
+
+	Vector v = vector_init(alloc, elem_size);
+	if (buf && capacity > 0)
+	{
+		v.data = buf;
+		v.capacity = capacity;
+		v.flags |= VECTOR_INLINE;
+	}
+	return (v);
+}
+
+/* Allocator of a static vector, never hands out memory. */
+static void *vector_fixed_alloc(void *ctx, size_t size, size_t align)
+{
+	(void)ctx;
+	(void)size;
+	(void)align;
+	return (NULL);
+}
+
+/*
+ * Fixed-capacity vector over caller memory that never touches an allocator:
+ * anything that would need more than capacity elements returns false, and
+ * shrink/destroy leave buf alone. The capacity check only runs where a
+ * growing vector would call the allocator anyway, so the push fast path is
+ * the same compare as for any other vector.
+*/
+Vector vector_init_static(void *buf, size_t capacity, size_t elem_size)
+{
+	Allocator none = allocator_make(vector_fixed_alloc, NULL, NULL, NULL);
+	Vector v = vector_init_buffer(none, elem_size, buf, capacity);
+	v.flags |= VECTOR_FIXED;
 	return (v);
 }
 
 
+/* ==================== */
+/* -- Shared buffers -- */
+/* ==================== */
+
+static inline void vector_refs_acquire(size_t *refs)
+{
+#if defined(__GNUC__)
+	__atomic_fetch_add(refs, 1, __ATOMIC_RELAXED);
+#else
+	(*refs)++;
+#endif
+}
+
+/* Drops one reference and returns how many are left. */
+static inline size_t vector_refs_release(size_t *refs)
+{
+#if defined(__GNUC__)
+	return (__atomic_sub_fetch(refs, 1, __ATOMIC_ACQ_REL));
+#else
+	return (--(*refs));
+#endif
+}
+
+static inline size_t vector_refs_count(size_t *refs)
+{
+#if defined(__GNUC__)
+	return (__atomic_load_n(refs, __ATOMIC_ACQUIRE));
+#else
+	return (*refs);
+#endif
+}
+
 /* ==================== */
 /* -- Modifiers      -- */
 /* ==================== */
+/*
+ * Capacity of the current block: at least capacity elements, plus whatever
+ * slack the allocator reports beyond the requested size.
+*/
+static size_t vector_usable_capacity(const Vector *v, size_t capacity)
+{
+	if (!v->alloc.usable_size)
+		return (capacity);
+
+	size_t bytes = v->alloc.usable_size(v->alloc.ctx, v->data, capacity * v->elem_size);
+	size_t usable = bytes / v->elem_size;
+	return (usable > capacity ? usable : capacity);
+}
+
+/*
+ * Gives v a buffer of its own with room for capacity elements. The last
+ * clone left just takes the shared buffer over, any other copies it out.
+*/
+static bool vector_unshare(Vector *v, size_t capacity)
+{
+	size_t *refs = v->refs;
+
+	if (vector_refs_count(refs) == 1)
+	{
+		free(refs);
+		v->refs = NULL;
+		return (capacity <= v->capacity || vector_reserve(v, capacity));
+	}
+	// A fixed buffer has no allocator to copy out into
+	if (v->flags & VECTOR_FIXED)
+		return (false);
+
+	if (capacity > SIZE_MAX / v->elem_size)
+	{
+		assert(0 && "vector_reserve: size overflow");
+		return (false);
+	}
+
+	void *new_block = v->alloc.alloc(v->alloc.ctx, capacity * v->elem_size, v->align);
+	if (!new_block)
+	{
+		assert(0 && "vector_reserve: alloc failed");
+		return (false);
+	}
+	memcpy(new_block, v->data, v->size * v->elem_size);
+	VECTOR_STAT_ADD(bytes_copied, v->size * v->elem_size);
+	VECTOR_STAT_ADD(allocs, 1);
+
+	// Whoever else held the buffer may have let go in the meantime
+	if (vector_refs_release(refs) == 0)
+	{
+		if (v->alloc.free)
+			v->alloc.free(v->alloc.ctx, v->data);
+		free(refs);
+	}
+	v->data = new_block;
+	v->refs = NULL;
+	v->capacity = vector_usable_capacity(v, capacity);
+	VECTOR_STAT_PEAK(v->capacity * v->elem_size);
+	return (true);
+}
+
 bool vector_reserve(Vector *v, size_t new_capacity)
 {
 	assert(vector_is_valid(v) && "invalid vector");
@@ -205,16 +815,33 @@ bool vector_reserve(Vector *v, size_t new_capacity)
 		return (false);
 	if (new_capacity <= v->capacity)
 		return (true);
+	if ((v->flags & VECTOR_FIXED) || (v->growth.max_capacity && new_capacity > v->growth.max_capacity))
+		return (false);
 	if (v->elem_size != 0 && new_capacity > SIZE_MAX / v->elem_size)
 	{
 		assert(0 && "vector_reserve: size overflow");
 		return (false);
 	}
 
+	// A shared buffer is copied straight into the new capacity
+	if (v->refs)
+		return (vector_unshare(v, new_capacity));
+
 	size_t alloc_size = new_capacity * v->elem_size;
 	size_t old_size = v->capacity * v->elem_size;
+	bool owned = v->data && !(v->flags & VECTOR_INLINE);
 
-	if (v->data && v->alloc.realloc)
+	// Growing in place skips both the realloc and the copy of the old contents
+	if (owned && v->alloc.expand_in_place
+		&& v->alloc.expand_in_place(v->alloc.ctx, v->data, old_size, alloc_size))
+	{
+		v->capacity = vector_usable_capacity(v, new_capacity);
+		VECTOR_STAT_ADD(expands_in_place, 1);
+		VECTOR_STAT_PEAK(v->capacity * v->elem_size);
+		return (true);
+	}
+
+	if (owned && v->alloc.realloc)
 	{
 		void *p = v->alloc.realloc(v->alloc.ctx, v->data, old_size, alloc_size, v->align);
 		if (!p)
@@ -223,6 +850,7 @@ bool vector_reserve(Vector *v, size_t new_capacity)
 			return (false);
 		}
 		v->data = p;
+		VECTOR_STAT_ADD(reallocs, 1);
 	}
 	else
 	{
@@ -235,13 +863,17 @@ bool vector_reserve(Vector *v, size_t new_capacity)
 		if (v->data)
 		{
 			memcpy(new_block, v->data, v->size * v->elem_size);
-			if (v->alloc.free)
+			VECTOR_STAT_ADD(bytes_copied, v->size * v->elem_size);
+			if (v->alloc.free && !(v->flags & VECTOR_INLINE))
 				v->alloc.free(v->alloc.ctx, v->data);
 		}
 		v->data = new_block;
+		v->flags &= ~VECTOR_INLINE;
+		VECTOR_STAT_ADD(allocs, 1);
 	}
 
-	v->capacity = new_capacity;
+	v->capacity = vector_usable_capacity(v, new_capacity);
+	VECTOR_STAT_PEAK(v->capacity * v->elem_size);
 	return (true);
 }
 
@@ -258,7 +890,23 @@ void vector_destroy(Vector *v)
 	if (!v)
 		return;
 
-	if (v->data && v->alloc.free)
+#ifdef VECTOR_STATS
+	if (v->elem_size > 0)
+	{
+		VECTOR_STAT_ADD(destroyed, 1);
+		VECTOR_STAT_ADD(destroyed_size_bytes, v->size * v->elem_size);
+		VECTOR_STAT_ADD(destroyed_capacity_bytes, v->capacity * v->elem_size);
+		if (g_vector_stats_hook)
+			g_vector_stats_hook(v, g_vector_stats_user);
+	}
+#endif
+
+	// Only the last clone sharing the buffer frees it
+	if (v->refs && vector_refs_release(v->refs) > 0)
+		v->data = NULL;
+	else if (v->refs)
+		free(v->refs);
+	if (v->data && v->alloc.free && !(v->flags & VECTOR_INLINE))
 		v->alloc.free(v->alloc.ctx, v->data);
 	v->size = 0;
 	v->capacity = 0;
@@ -269,20 +917,144 @@ void vector_destroy(Vector *v)
 	v->alloc.free = NULL;
 	v->alloc.realloc = NULL;
 	v->alloc.ctx = NULL;
+	v->alloc.usable_size = NULL;
+	v->alloc.expand_in_place = NULL;
+	v->alloc.alloc_zeroed = NULL;
+	memset(&v->growth, 0, sizeof(v->growth));
+	v->flags = 0;
+	v->refs = NULL;
+}
+
+/* ==================== */
+/* -- Growth policy  -- */
+/* ==================== */
+
+/* Rounds bytes up to a size class, four classes per power of two. */
+static size_t round_size_class(size_t bytes)
+{
+	size_t high = 1;
+
+	while (high <= bytes / 2)
+		high *= 2;
+	if (high < 4 || bytes == high)
+		return (bytes);
+
+	size_t step = high / 4;
+	size_t rounded = (bytes + step - 1) & ~(step - 1);
+	return (rounded < bytes ? bytes : rounded);
+}
+
+/*
+ * Applies the vector's growth policy, starting from the current capacity,
+ * until at least min_capacity elements fit.
+*/
+static size_t vector_next_capacity(const Vector *v, size_t min_capacity)
+{
+	const VectorGrowth	*g = &v->growth;
+	size_t				num = g->factor_num ? g->factor_num : GROWTH_FACTOR;
+	size_t				den = g->factor_den ? g->factor_den : 1;
+	size_t				new_capacity = v->capacity;
+
+	assert(num > den && "growth factor must be > 1");
+	// A policy that got past vector_set_growth must still grow
+	if (num <= den)
+	{
+		num = GROWTH_FACTOR;
+		den = 1;
+	}
+
+	size_t d = num - den;
+	if (new_capacity == 0)
+		new_capacity = g->initial ? g->initial : 8;
+	while (new_capacity < min_capacity)
+	{
+		size_t q = new_capacity / den;
+		size_t r = new_capacity % den;
+		size_t step = SIZE_MAX;
+
+		// capacity * (num - den) / den, in two parts so neither overflows
+		if (q <= SIZE_MAX / d && (r == 0 || d <= SIZE_MAX / r))
+		{
+			step = q * d;
+			step = step > SIZE_MAX - r * d / den ? SIZE_MAX : step + r * d / den;
+		}
+
+		if (g->linear_cap && step > g->linear_cap / v->elem_size)
+			step = g->linear_cap / v->elem_size;
+		if (step == 0)
+			step = 1;
+		if (new_capacity > SIZE_MAX - step)
+			return (SIZE_MAX);
+		new_capacity += step;
+	}
+
+	if (g->round_threshold && new_capacity <= SIZE_MAX / v->elem_size
+		&& new_capacity * v->elem_size >= g->round_threshold)
+	{
+		size_t bytes = new_capacity * v->elem_size;
+		size_t rounded;
+
+		if (g->round_to)
+		{
+			rounded = (bytes + g->round_to - 1) / g->round_to * g->round_to;
+			if (rounded < bytes)
+				rounded = bytes;
+		}
+		else
+			rounded = round_size_class(bytes);
+		new_capacity = rounded / v->elem_size;
+	}
+	// Past the cap only what was asked for, which the reserve then refuses
+	if (g->max_capacity && new_capacity > g->max_capacity)
+		new_capacity = min_capacity > g->max_capacity ? min_capacity : g->max_capacity;
+	return (new_capacity);
+}
+
+/* Sets the growth policy. One whose factor isn't above 1 is refused, the old one stays. */
+void vector_set_growth(Vector *v, VectorGrowth growth)
+{
+	// Zero fields stand for their defaults, check the factor they amount to
+	bool valid = (growth.factor_num ? growth.factor_num : GROWTH_FACTOR)
+		> (growth.factor_den ? growth.factor_den : 1);
+
+	assert(vector_is_valid(v) && "invalid vector");
+	assert(valid && "growth factor must be > 1");
+
+	if (v && valid)
+		v->growth = growth;
 }
 
 static bool grow_vector(Vector *v)
 {
-	size_t new_capacity;
+	if (v->capacity == SIZE_MAX)
+		return (false);
+	VECTOR_STAT_ADD(grows, 1);
+	return (vector_reserve(v, vector_next_capacity(v, v->capacity + 1)));
+}
 
-	if (v->capacity == 0)
-		new_capacity = 8;
-	else if (v->capacity > SIZE_MAX / GROWTH_FACTOR)
-		new_capacity = SIZE_MAX;
-	else
-		new_capacity = v->capacity * GROWTH_FACTOR;
+/*
+ * Grows by the growth policy until at least min_capacity elements fit, so
+ * repeated bulk operations keep the amortized O(1) cost of vector_push.
+*/
+static bool grow_vector_to(Vector *v, size_t min_capacity)
+{
+	if (min_capacity <= v->capacity)
+		return (true);
+	VECTOR_STAT_ADD(grows, 1);
+	return (vector_reserve(v, vector_next_capacity(v, min_capacity)));
+}
+
+/*
+ * Grows the capacity by the growth policy the same way vector_push does.
+ * 		Used by the VECTOR_DEFINE typed family for its inline fast paths.
+*/
+bool vector_grow(Vector *v)
+{
+	assert(vector_is_valid(v) && "invalid vector");
 
-	return (vector_reserve(v, new_capacity));
+	if (!v)
+		return (false);
+	return (grow_vector(v));
 }
 
 bool vector_push(Vector *v, void *elem)
@@ -293,7 +1065,7 @@ bool vector_push(Vector *v, void *elem)
 	if (!v || !elem)
 		return (false);
 
-	if (v->size == v->capacity && !grow_vector(v))
+	if (v->size == v->capacity ? !grow_vector(v) : (v->refs && !vector_unshare(v, v->capacity)))
 		return (false);
 
 	char *data = (char *)v->data;
@@ -310,7 +1082,7 @@ bool vector_insert(Vector *v, size_t index, void *elem)
 
 	if (!v || !elem || index > v->size)
 		return (false);
-	if (v->size == v->capacity && !grow_vector(v))
+	if (v->size == v->capacity ? !grow_vector(v) : (v->refs && !vector_unshare(v, v->capacity)))
 		return (false);
 
 	char *data = (char *)v->data;
@@ -333,6 +1105,8 @@ bool vector_erase(Vector *v, size_t index)
 
 	if (!v || index >= v->size)
 		return (false);
+	if (v->refs && !vector_unshare(v, v->capacity))
+		return (false);
 
 	char *data = (char *)v->data;
 
@@ -363,8 +1137,14 @@ bool vector_shrink_to_fit(Vector *v)
 
 	if (!v)
 		return (false);
-	if (v->size == v->capacity)
+	// The inline buffer isn't ours to give back, a fixed one can't be swapped
+	if (v->size == v->capacity || (v->flags & (VECTOR_INLINE | VECTOR_FIXED)))
 		return (true);
+	// Copying out of a shared buffer is the shrink
+	if (v->refs && v->size > 0 && vector_refs_count(v->refs) > 1)
+		return (vector_unshare(v, v->size));
+	if (v->refs && !vector_unshare(v, v->capacity))
+		return (false);
 
 	size_t old_size = v->capacity * v->elem_size;
 
@@ -391,6 +1171,7 @@ bool vector_shrink_to_fit(Vector *v)
 			return (false);
 		}
 		v->data = p;
+		VECTOR_STAT_ADD(reallocs, 1);
 	}
 	else if (v->alloc.alloc)
 	{
@@ -402,9 +1183,11 @@ bool vector_shrink_to_fit(Vector *v)
 		}
 
 		memcpy(new_block, v->data, alloc_size);
+		VECTOR_STAT_ADD(bytes_copied, alloc_size);
 		if (v->alloc.free)
 			v->alloc.free(v->alloc.ctx, v->data);
 		v->data = new_block;
+		VECTOR_STAT_ADD(allocs, 1);
 	}
 	v->capacity = v->size;
 	return (true);
@@ -422,6 +1205,8 @@ bool vector_swap_pop(Vector *v, size_t index)
 
 	if (!v || index >= v->size)
 		return (false);
+	if (v->refs && !vector_unshare(v, v->capacity))
+		return (false);
 
 	if (index == v->size - 1)
 	{
@@ -438,5 +1223,367 @@ bool vector_swap_pop(Vector *v, size_t index)
 	return (true);
 }
 
+/* ======================== */
+/* -- Bulk modifiers     -- */
+/* ======================== */
+
+/* Appends count elements from src with a single reserve and memcpy. */
+bool vector_push_n(Vector *v, const void *src, size_t count)
+{
+	assert(vector_is_valid(v) && "invalid vector");
+	assert((src != NULL || count == 0) && "source is NULL");
+
+	if (!v || (!src && count > 0))
+		return (false);
+	if (count == 0)
+		return (true);
+	if (count > SIZE_MAX - v->size)
+	{
+		assert(0 && "vector_push_n: size overflow");
+		return (false);
+	}
+	if (!grow_vector_to(v, v->size + count))
+		return (false);
+	if (v->refs && !vector_unshare(v, v->capacity))
+		return (false);
+
+	char *data = (char *)v->data;
+	memcpy(data + v->size * v->elem_size, src, count * v->elem_size);
+	v->size += count;
+	return (true);
+}
+
+/* Inserts count elements from src at index, moving the tail only once. */
+bool vector_insert_n(Vector *v, size_t index, const void *src, size_t count)
+{
+	assert(vector_is_valid(v) && "invalid vector");
+	assert((src != NULL || count == 0) && "source is NULL");
+	assert(index <= v->size && "index out of bounds");
+
+	if (!v || (!src && count > 0) || index > v->size)
+		return (false);
+	if (count == 0)
+		return (true);
+	if (count > SIZE_MAX - v->size)
+	{
+		assert(0 && "vector_insert_n: size overflow");
+		return (false);
+	}
+	if (!grow_vector_to(v, v->size + count))
+		return (false);
+	if (v->refs && !vector_unshare(v, v->capacity))
+		return (false);
+
+	char *data = (char *)v->data;
+
+	memmove(
+		data + (index + count) * v->elem_size,
+		data + index * v->elem_size,
+		(v->size - index) * v->elem_size
+	);
+
+	memcpy(data + index * v->elem_size, src, count * v->elem_size);
+	v->size += count;
+	return (true);
+}
+
+/* Erases the elements in [first, last), preserving order. */
+bool vector_erase_range(Vector *v, size_t first, size_t last)
+{
+	assert(vector_is_valid(v) && "invalid vector");
+	assert(first <= last && last <= v->size && "range out of bounds");
+
+	if (!v || first > last || last > v->size)
+		return (false);
+	if (first == last)
+		return (true);
+	if (v->refs && !vector_unshare(v, v->capacity))
+		return (false);
+
+	char *data = (char *)v->data;
+
+	memmove(
+		data + first * v->elem_size,
+		data + last * v->elem_size,
+		(v->size - last) * v->elem_size
+	);
+	v->size -= last - first;
+	return (true);
+}
+
+/*
+ * Appends every element of src to dst.
+ * 		Note: src may be dst itself, the data pointer is re-read after
+ * 		the reserve so a self-append doesn't copy from a freed block.
+*/
+bool vector_append(Vector *dst, const Vector *src)
+{
+	assert(vector_is_valid(dst) && "invalid vector");
+	assert(vector_is_valid(src) && "invalid vector");
+	assert(dst->elem_size == src->elem_size && "element size mismatch");
+
+	if (!dst || !src || dst->elem_size != src->elem_size)
+		return (false);
+
+	size_t count = src->size;
+
+	if (count == 0)
+		return (true);
+	if (count > SIZE_MAX - dst->size)
+	{
+		assert(0 && "vector_append: size overflow");
+		return (false);
+	}
+	if (!grow_vector_to(dst, dst->size + count))
+		return (false);
+	if (dst->refs && !vector_unshare(dst, dst->capacity))
+		return (false);
+
+	char *data = (char *)dst->data;
+	memcpy(data + dst->size * dst->elem_size, src->data, count * dst->elem_size);
+	dst->size += count;
+	return (true);
+}
+
+/* ======================== */
+/* -- Cloning            -- */
+/* ======================== */
+
+/* Deep copy of src into dst, using the same allocator, alignment and growth policy. */
+bool vector_clone(Vector *dst, const Vector *src)
+{
+	assert(dst != NULL && vector_is_valid(src) && "invalid vector");
+
+	if (!dst || !src)
+		return (false);
+	// A static vector has no allocator to copy into
+	if (src->flags & VECTOR_FIXED)
+		return (false);
+
+	*dst = vector_init_aligned(src->alloc, src->elem_size, src->align);
+	dst->growth = src->growth;
+	if (src->size == 0)
+		return (true);
+	if (!vector_reserve(dst, src->size))
+		return (false);
+	memcpy(dst->data, src->data, src->size * src->elem_size);
+	dst->size = src->size;
+	return (true);
+}
+
+/*
+ * O(1) copy-on-write clone: dst shares src's buffer through a refcount, and
+ * whichever vector first modifies its contents (push, insert, erase, ...)
+ * copies the buffer out then. Read-only clones never copy.
+ * 		Note: clones may live on different threads, then the allocator has
+ * 		to be thread-safe. Inline buffers can't be shared (they may live on
+ * 		the stack), those are deep copied instead.
+*/
+bool vector_clone_shared(Vector *dst, Vector *src)
+{
+	assert(dst != NULL && vector_is_valid(src) && "invalid vector");
+
+	if (!dst || !src)
+		return (false);
+	if (!src->data || (src->flags & VECTOR_INLINE))
+		return (vector_clone(dst, src));
+	if (!src->refs)
+	{
+		// From malloc, whatever the buffer came from: vm regions, mapped files
+		// and static vectors have no second block to give, arenas never free it
+		size_t *refs = (size_t *)malloc(sizeof(size_t));
+		if (!refs)
+		{
+			assert(0 && "vector_clone_shared: alloc failed");
+			return (false);
+		}
+		*refs = 1;
+		src->refs = refs;
+	}
+	vector_refs_acquire(src->refs);
+	*dst = *src;
+	return (true);
+}
+
+/*
+ * Makes sure v has a buffer of its own, copying it out of a shared one if
+ * needed. Call it before writing through vector_data_as or vector_at
+ * pointers on a vector that may be a shared clone.
+*/
+bool vector_make_unique(Vector *v)
+{
+	assert(vector_is_valid(v) && "invalid vector");
+
+	if (!v)
+		return (false);
+	return (!v->refs || vector_unshare(v, v->capacity));
+}
+
+/* ======================== */
+/* -- Resizing           -- */
+/* ======================== */
+
+/*
+ * Moves the contents into a fresh zeroed block of at least new_capacity
+ * elements, so the tail past size never has to be written.
+*/
+static bool vector_reserve_zeroed(Vector *v, size_t new_capacity)
+{
+	if (v->growth.max_capacity && new_capacity > v->growth.max_capacity)
+		return (false);
+	if (new_capacity > SIZE_MAX / v->elem_size)
+	{
+		assert(0 && "vector_resize: size overflow");
+		return (false);
+	}
+
+	void *new_block = v->alloc.alloc_zeroed(v->alloc.ctx, new_capacity * v->elem_size, v->align);
+	if (!new_block)
+	{
+		assert(0 && "vector_resize: alloc failed");
+		return (false);
+	}
+	if (v->data)
+	{
+		memcpy(new_block, v->data, v->size * v->elem_size);
+		VECTOR_STAT_ADD(bytes_copied, v->size * v->elem_size);
+		if (v->alloc.free && !(v->flags & VECTOR_INLINE))
+			v->alloc.free(v->alloc.ctx, v->data);
+	}
+	v->data = new_block;
+	v->flags &= ~VECTOR_INLINE;
+	v->capacity = vector_usable_capacity(v, new_capacity);
+	VECTOR_STAT_ADD(allocs, 1);
+	VECTOR_STAT_PEAK(v->capacity * v->elem_size);
+	return (true);
+}
+
+/*
+ * Sets the size to new_size, new elements are zero. Shrinking keeps the
+ * capacity, like vector_clear.
+ * 		Note: when the vector has to move anyway and the zeroed tail is at
+ * 		least as big as the current contents, a zeroed block comes from the
+ * 		allocator's alloc_zeroed (calloc for malloc_allocator), so pages that
+ * 		are already zero are never written.
+*/
+bool vector_resize(Vector *v, size_t new_size)
+{
+	assert(vector_is_valid(v) && "invalid vector");
+
+	if (!v)
+		return (false);
+
+	size_t old_size = v->size;
+
+	if (new_size <= old_size)
+	{
+		v->size = new_size;
+		return (true);
+	}
+	// Growing in place beats a fresh block, it copies nothing
+	bool can_expand = v->data && !(v->flags & VECTOR_INLINE) && v->alloc.expand_in_place;
+
+	if (new_size > v->capacity && v->alloc.alloc_zeroed && !can_expand && !v->refs
+		&& new_size - old_size >= old_size)
+	{
+		VECTOR_STAT_ADD(grows, 1);
+		if (!vector_reserve_zeroed(v, vector_next_capacity(v, new_size)))
+			return (false);
+		v->size = new_size;
+		return (true);
+	}
+	if (!grow_vector_to(v, new_size))
+		return (false);
+	if (v->refs && !vector_unshare(v, v->capacity))
+		return (false);
+
+	memset((char *)v->data + old_size * v->elem_size, 0, (new_size - old_size) * v->elem_size);
+	v->size = new_size;
+	return (true);
+}
+
+/* Sets the size to new_size, new elements are left uninitialized for the caller to overwrite. */
+bool vector_resize_uninit(Vector *v, size_t new_size)
+{
+	assert(vector_is_valid(v) && "invalid vector");
+
+	if (!v)
+		return (false);
+	if (new_size > v->size && !grow_vector_to(v, new_size))
+		return (false);
+	if (v->refs && !vector_unshare(v, v->capacity))
+		return (false);
+	v->size = new_size;
+	return (true);
+}
+
+/* Sets the size to new_size, new elements are copies of value. */
+bool vector_resize_fill(Vector *v, size_t new_size, const void *value)
+{
+	assert(vector_is_valid(v) && "invalid vector");
+	assert(value != NULL && "value is NULL");
+
+	if (!v || !value)
+		return (false);
+
+	size_t old_size = v->size;
+
+	if (!vector_resize_uninit(v, new_size))
+		return (false);
+	if (new_size <= old_size)
+		return (true);
+
+	// Copy one element, then keep doubling the filled run
+	char	*dst = (char *)v->data + old_size * v->elem_size;
+	size_t	total = (new_size - old_size) * v->elem_size;
+	size_t	filled = v->elem_size;
+
+	memcpy(dst, value, v->elem_size);
+	while (filled < total)
+	{
+		size_t n = filled < total - filled ? filled : total - filled;
+		memcpy(dst + filled, dst, n);
+		filled += n;
+	}
+	return (true);
+}
+
+/* ================================ */
+/* -- Writing into spare capacity -- */
+/* ================================ */
+
+/*
+ * Returns the unused slots past size and stores how many there are in count,
+ * growing by the growth policy first if the vector is full. I/O or a parser
+ * can write elements there directly, then publish them with vector_commit.
+ * 		Note: the pointer is invalidated by anything that reallocates.
+*/
+void *vector_spare(Vector *v, size_t *count)
+{
+	assert(vector_is_valid(v) && "invalid vector");
+	assert(count != NULL && "count is NULL");
+
+	if (!v || !count)
+		return (NULL);
+	*count = 0;
+	if (v->size == v->capacity ? !grow_vector(v) : (v->refs && !vector_unshare(v, v->capacity)))
+		return (NULL);
+
+	*count = v->capacity - v->size;
+	return ((char *)v->data + v->size * v->elem_size);
+}
+
+/* Marks count elements written into the spare capacity as part of the vector. */
+bool vector_commit(Vector *v, size_t count)
+{
+	assert(vector_is_valid(v) && "invalid vector");
+	assert(count <= v->capacity - v->size && "commit past capacity");
+
+	if (!v || count > v->capacity - v->size)
+		return (false);
+	v->size += count;
+	return (true);
+}
+
 #endif // VECTOR_IMPLEMENTATION_GUARD
 #endif // VECTOR_IMPLEMENTATION
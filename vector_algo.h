@@ -0,0 +1,842 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_ALGO.H v1.0.0
+   -----------------------------------------------------------------------------
+   Search, fill, compare and sort algorithms over a Vector's contiguous data,
+   with SSE2/AVX2/NEON fast paths for 1, 2, 4 and 8 byte elements and a
+   generic byte-wise fallback for any other elem_size.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/vector
+   License: MIT
+   -----------------------------------------------------------------------------
+
+   USAGE:
+	 int id = 1337;
+	 size_t i = vector_find(&v, &id);	// VECTOR_NPOS if not found
+	 size_t n = vector_count(&v, &id);
+	 vector_fill(&v, &id);
+	 bool same = vector_equal(&v, &w);
+
+	 Elements compare by their bytes, so padding bytes in structs take part.
+
+	 vector_sort(&v, VECTOR_KEY_I32);		// radix sort on scalar keys
+	 vector_sort_by(&v, cmp_by_name, NULL);	// introsort with a comparator
+	 size_t at = vector_lower_bound(&v, &id, VECTOR_KEY_I32);
+	 size_t hit = vector_binary_search(&v, &id, VECTOR_KEY_I32);
+
+	 vector_remove_if(&v, is_expired, &now);	// stable, single pass
+	 vector_insert_sorted_batch(&v, batch, n, cmp_by_id, NULL);
+*/
+
+#ifndef VECTOR_ALGO_H
+# define VECTOR_ALGO_H
+
+#include "vector.h"
+
+#ifndef VECTOR_NPOS
+# define VECTOR_NPOS ((size_t)-1)	// also defined by vector_bits.h
+#endif
+
+/* ==================== */
+/* -- SIMD kernels   -- */
+/* ==================== */
+
+/*
+ * Each backend provides a register type, unaligned load/store, a splat of a
+ * 1/2/4/8 byte element and a compare that returns ALGO_MASK_BITS mask bits
+ * per byte of the register that matched.
+*/
+#if defined(__GNUC__) && defined(__AVX2__)
+# include <immintrin.h>
+# define ALGO_SIMD
+# define ALGO_SIMD_BYTES	32
+# define ALGO_MASK_BITS		1
+
+typedef __m256i algo_vec;
+
+static inline algo_vec algo_load(const void *p)
+{
+	return (_mm256_loadu_si256((const __m256i *)p));
+}
+
+static inline void algo_store(void *p, algo_vec x)
+{
+	_mm256_storeu_si256((__m256i *)p, x);
+}
+
+static inline algo_vec algo_splat(const void *elem, size_t w)
+{
+	uint16_t	u16;
+	uint32_t	u32;
+	uint64_t	u64;
+
+	switch (w)
+	{
+		case 1: return (_mm256_set1_epi8(*(const char *)elem));
+		case 2: memcpy(&u16, elem, 2); return (_mm256_set1_epi16((short)u16));
+		case 4: memcpy(&u32, elem, 4); return (_mm256_set1_epi32((int)u32));
+		default: memcpy(&u64, elem, 8); return (_mm256_set1_epi64x((long long)u64));
+	}
+}
+
+static inline uint64_t algo_eq_mask(algo_vec x, algo_vec y, size_t w)
+{
+	algo_vec eq;
+
+	switch (w)
+	{
+		case 1: eq = _mm256_cmpeq_epi8(x, y); break;
+		case 2: eq = _mm256_cmpeq_epi16(x, y); break;
+		case 4: eq = _mm256_cmpeq_epi32(x, y); break;
+		default: eq = _mm256_cmpeq_epi64(x, y); break;
+	}
+	return ((uint32_t)_mm256_movemask_epi8(eq));
+}
+
+#elif defined(__GNUC__) && defined(__SSE2__)
+# include <emmintrin.h>
+# define ALGO_SIMD
+# define ALGO_SIMD_BYTES	16
+# define ALGO_MASK_BITS		1
+
+typedef __m128i algo_vec;
+
+static inline algo_vec algo_load(const void *p)
+{
+	return (_mm_loadu_si128((const __m128i *)p));
+}
+
+static inline void algo_store(void *p, algo_vec x)
+{
+	_mm_storeu_si128((__m128i *)p, x);
+}
+
+static inline algo_vec algo_splat(const void *elem, size_t w)
+{
+	uint16_t	u16;
+	uint32_t	u32;
+	uint64_t	u64;
+
+	switch (w)
+	{
+		case 1: return (_mm_set1_epi8(*(const char *)elem));
+		case 2: memcpy(&u16, elem, 2); return (_mm_set1_epi16((short)u16));
+		case 4: memcpy(&u32, elem, 4); return (_mm_set1_epi32((int)u32));
+		default: memcpy(&u64, elem, 8); return (_mm_set1_epi64x((long long)u64));
+	}
+}
+
+static inline uint64_t algo_eq_mask(algo_vec x, algo_vec y, size_t w)
+{
+	algo_vec eq;
+
+	switch (w)
+	{
+		case 1: eq = _mm_cmpeq_epi8(x, y); break;
+		case 2: eq = _mm_cmpeq_epi16(x, y); break;
+		case 4: eq = _mm_cmpeq_epi32(x, y); break;
+		default:
+			// SSE2 has no 64-bit compare: both 32-bit halves have to match
+			eq = _mm_cmpeq_epi32(x, y);
+			eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+			break;
+	}
+	return ((uint32_t)_mm_movemask_epi8(eq));
+}
+
+#elif defined(__GNUC__) && defined(__ARM_NEON) && defined(__aarch64__)
+# include <arm_neon.h>
+# define ALGO_SIMD
+# define ALGO_SIMD_BYTES	16
+# define ALGO_MASK_BITS		4
+
+typedef uint8x16_t algo_vec;
+
+static inline algo_vec algo_load(const void *p)
+{
+	return (vld1q_u8((const uint8_t *)p));
+}
+
+static inline void algo_store(void *p, algo_vec x)
+{
+	vst1q_u8((uint8_t *)p, x);
+}
+
+static inline algo_vec algo_splat(const void *elem, size_t w)
+{
+	uint16_t	u16;
+	uint32_t	u32;
+	uint64_t	u64;
+
+	switch (w)
+	{
+		case 1: return (vdupq_n_u8(*(const uint8_t *)elem));
+		case 2: memcpy(&u16, elem, 2); return (vreinterpretq_u8_u16(vdupq_n_u16(u16)));
+		case 4: memcpy(&u32, elem, 4); return (vreinterpretq_u8_u32(vdupq_n_u32(u32)));
+		default: memcpy(&u64, elem, 8); return (vreinterpretq_u8_u64(vdupq_n_u64(u64)));
+	}
+}
+
+/* NEON has no movemask, narrowing by 4 bits per byte gives the same information. */
+static inline uint64_t algo_eq_mask(algo_vec x, algo_vec y, size_t w)
+{
+	uint8x16_t eq;
+
+	switch (w)
+	{
+		case 1: eq = vceqq_u8(x, y); break;
+		case 2: eq = vreinterpretq_u8_u16(vceqq_u16(vreinterpretq_u16_u8(x), vreinterpretq_u16_u8(y))); break;
+		case 4: eq = vreinterpretq_u8_u32(vceqq_u32(vreinterpretq_u32_u8(x), vreinterpretq_u32_u8(y))); break;
+		default: eq = vreinterpretq_u8_u64(vceqq_u64(vreinterpretq_u64_u8(x), vreinterpretq_u64_u8(y))); break;
+	}
+	return (vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0));
+}
+#endif
+
+static inline bool algo_simd_width(size_t w)
+{
+	return (w == 1 || w == 2 || w == 4 || w == 8);
+}
+
+/* ==================== */
+/* -- Algorithms     -- */
+/* ==================== */
+
+/* Index of the first element equal to elem, VECTOR_NPOS if there is none. */
+static size_t vector_find(const Vector *v, const void *elem)
+{
+	assert(v != NULL && elem != NULL && "vector_find: NULL argument");
+
+	const char	*data = (const char *)v->data;
+	size_t		w = v->elem_size;
+	size_t		i = 0;
+
+	if (v->size == 0)
+		return (VECTOR_NPOS);
+	// libc's memchr is already vectorized
+	if (w == 1)
+	{
+		const char *hit = (const char *)memchr(data, *(const unsigned char *)elem, v->size);
+		return (hit ? (size_t)(hit - data) : VECTOR_NPOS);
+	}
+#ifdef ALGO_SIMD
+	if (algo_simd_width(w))
+	{
+		size_t		bytes = v->size * w;
+		algo_vec	needle = algo_splat(elem, w);
+
+		for (; i + ALGO_SIMD_BYTES <= bytes; i += ALGO_SIMD_BYTES)
+		{
+			uint64_t mask = algo_eq_mask(algo_load(data + i), needle, w);
+			if (mask)
+				return ((i + (size_t)__builtin_ctzll(mask) / ALGO_MASK_BITS) / w);
+		}
+		i /= w;
+	}
+#endif
+	for (; i < v->size; ++i)
+	{
+		if (memcmp(data + i * w, elem, w) == 0)
+			return (i);
+	}
+	return (VECTOR_NPOS);
+}
+
+/* Number of elements equal to elem. */
+static size_t vector_count(const Vector *v, const void *elem)
+{
+	assert(v != NULL && elem != NULL && "vector_count: NULL argument");
+
+	const char	*data = (const char *)v->data;
+	size_t		w = v->elem_size;
+	size_t		count = 0;
+	size_t		i = 0;
+
+#ifdef ALGO_SIMD
+	if (algo_simd_width(w))
+	{
+		size_t		bytes = v->size * w;
+		size_t		bits = 0;
+		algo_vec	needle = algo_splat(elem, w);
+
+		// Every match sets w * ALGO_MASK_BITS bits of the mask
+		for (; i + ALGO_SIMD_BYTES <= bytes; i += ALGO_SIMD_BYTES)
+			bits += (size_t)__builtin_popcountll(algo_eq_mask(algo_load(data + i), needle, w));
+		count = bits / (w * ALGO_MASK_BITS);
+		i /= w;
+	}
+#endif
+	for (; i < v->size; ++i)
+	{
+		if (memcmp(data + i * w, elem, w) == 0)
+			count++;
+	}
+	return (count);
+}
+
+/* Sets every element in [0, size) to elem. */
+static void vector_fill(Vector *v, const void *elem)
+{
+	assert(v != NULL && elem != NULL && "vector_fill: NULL argument");
+
+	if (v->size == 0 || !vector_make_unique(v))
+		return;
+
+	char	*data = (char *)v->data;
+	size_t	w = v->elem_size;
+	size_t	bytes = v->size * w;
+	size_t	done = 0;
+	if (w == 1)
+	{
+		memset(data, *(const unsigned char *)elem, v->size);
+		return;
+	}
+#ifdef ALGO_SIMD
+	if (algo_simd_width(w))
+	{
+		algo_vec pattern = algo_splat(elem, w);
+
+		for (; done + ALGO_SIMD_BYTES <= bytes; done += ALGO_SIMD_BYTES)
+			algo_store(data + done, pattern);
+		for (; done < bytes; done += w)
+			memcpy(data + done, elem, w);
+		return;
+	}
+#endif
+	// Any other size: copy the filled prefix onto itself, doubling each time
+	memcpy(data, elem, w);
+	done = w;
+	while (done < bytes)
+	{
+		size_t chunk = done < bytes - done ? done : bytes - done;
+		memcpy(data + done, data, chunk);
+		done += chunk;
+	}
+}
+
+/*
+ * True if both vectors hold the same number of equal elements. A single
+ * memcmp is used for every elem_size, libc already vectorizes it.
+*/
+static bool vector_equal(const Vector *a, const Vector *b)
+{
+	assert(a != NULL && b != NULL && "vector_equal: NULL argument");
+
+	if (a->elem_size != b->elem_size || a->size != b->size)
+		return (false);
+	if (a->size == 0 || a->data == b->data)
+		return (true);
+	return (memcmp(a->data, b->data, a->size * a->elem_size) == 0);
+}
+
+/* ==================== */
+/* -- Sorting        -- */
+/* ==================== */
+
+/* Returns < 0, 0 or > 0 like qsort comparators, with a user context. */
+typedef int (*vector_cmp_fn)(const void *a, const void *b, void *ctx);
+
+/* Scalar element types vector_sort and the keyed searches understand. */
+typedef enum {
+	VECTOR_KEY_U8,
+	VECTOR_KEY_I8,
+	VECTOR_KEY_U16,
+	VECTOR_KEY_I16,
+	VECTOR_KEY_U32,
+	VECTOR_KEY_I32,
+	VECTOR_KEY_U64,
+	VECTOR_KEY_I64,
+	VECTOR_KEY_F32,
+	VECTOR_KEY_F64
+} VectorKey;
+
+#define ALGO_INSERTION_SORT	16	// ranges this small are insertion sorted
+#define ALGO_RADIX_MIN		64	// below this, radix passes cost more than they save
+
+static inline size_t algo_key_width(VectorKey key)
+{
+	static const size_t widths[] = { 1, 1, 2, 2, 4, 4, 8, 8, 4, 8 };
+
+	return (widths[key]);
+}
+
+/* Swaps whole words for the common sizes instead of looping over bytes. */
+static inline void algo_swap(char *a, char *b, size_t w)
+{
+	uint64_t	t64;
+	uint32_t	t32;
+	uint16_t	t16;
+	char		t8;
+
+	switch (w)
+	{
+		case 1: t8 = *a; *a = *b; *b = t8; return;
+		case 2: memcpy(&t16, a, 2); memcpy(a, b, 2); memcpy(b, &t16, 2); return;
+		case 4: memcpy(&t32, a, 4); memcpy(a, b, 4); memcpy(b, &t32, 4); return;
+		case 8: memcpy(&t64, a, 8); memcpy(a, b, 8); memcpy(b, &t64, 8); return;
+	}
+	for (; w >= 8; w -= 8, a += 8, b += 8)
+	{
+		memcpy(&t64, a, 8);
+		memcpy(a, b, 8);
+		memcpy(b, &t64, 8);
+	}
+	for (; w > 0; w--, a++, b++)
+	{
+		t8 = *a;
+		*a = *b;
+		*b = t8;
+	}
+}
+
+#define ALGO_CMP(T) \
+	{ \
+		T x, y; \
+		memcpy(&x, a, sizeof(T)); \
+		memcpy(&y, b, sizeof(T)); \
+		return ((x > y) - (x < y)); \
+	}
+
+/* Comparator over a VectorKey passed through ctx. */
+static int algo_key_cmp(const void *a, const void *b, void *ctx)
+{
+	switch (*(const VectorKey *)ctx)
+	{
+		case VECTOR_KEY_U8: ALGO_CMP(uint8_t)
+		case VECTOR_KEY_I8: ALGO_CMP(int8_t)
+		case VECTOR_KEY_U16: ALGO_CMP(uint16_t)
+		case VECTOR_KEY_I16: ALGO_CMP(int16_t)
+		case VECTOR_KEY_U32: ALGO_CMP(uint32_t)
+		case VECTOR_KEY_I32: ALGO_CMP(int32_t)
+		case VECTOR_KEY_U64: ALGO_CMP(uint64_t)
+		case VECTOR_KEY_I64: ALGO_CMP(int64_t)
+		case VECTOR_KEY_F32: ALGO_CMP(float)
+		case VECTOR_KEY_F64: ALGO_CMP(double)
+	}
+	return (0);
+}
+
+static void algo_insertion_sort(char *base, size_t n, size_t w, vector_cmp_fn cmp, void *ctx)
+{
+	for (size_t i = 1; i < n; ++i)
+	{
+		for (size_t j = i; j > 0 && cmp(base + (j - 1) * w, base + j * w, ctx) > 0; --j)
+			algo_swap(base + (j - 1) * w, base + j * w, w);
+	}
+}
+
+static void algo_sift_down(char *base, size_t root, size_t n, size_t w, vector_cmp_fn cmp, void *ctx)
+{
+	size_t child;
+
+	while ((child = 2 * root + 1) < n)
+	{
+		if (child + 1 < n && cmp(base + child * w, base + (child + 1) * w, ctx) < 0)
+			child++;
+		if (cmp(base + root * w, base + child * w, ctx) >= 0)
+			return;
+		algo_swap(base + root * w, base + child * w, w);
+		root = child;
+	}
+}
+
+static void algo_heap_sort(char *base, size_t n, size_t w, vector_cmp_fn cmp, void *ctx)
+{
+	for (size_t i = n / 2; i > 0; --i)
+		algo_sift_down(base, i - 1, n, w, cmp, ctx);
+	for (size_t end = n - 1; end > 0; --end)
+	{
+		algo_swap(base, base + end * w, w);
+		algo_sift_down(base, 0, end, w, cmp, ctx);
+	}
+}
+
+/*
+ * Introsort: median-of-three quicksort that falls back to heapsort once the
+ * recursion gets too deep, and finishes small ranges with insertion sort.
+ * Recurses into the smaller half so the stack stays O(log n).
+*/
+static void algo_intro_sort(char *base, size_t n, size_t w, vector_cmp_fn cmp, void *ctx, size_t depth)
+{
+	while (n > ALGO_INSERTION_SORT)
+	{
+		if (depth == 0)
+		{
+			algo_heap_sort(base, n, w, cmp, ctx);
+			return;
+		}
+		depth--;
+
+		char *a = base;
+		char *b = base + (n / 2) * w;
+		char *c = base + (n - 1) * w;
+		if (cmp(b, a, ctx) < 0)
+			algo_swap(a, b, w);
+		if (cmp(c, b, ctx) < 0)
+		{
+			algo_swap(b, c, w);
+			if (cmp(b, a, ctx) < 0)
+				algo_swap(a, b, w);
+		}
+		// Median to the front, it stays there as the pivot while partitioning
+		algo_swap(a, b, w);
+
+		size_t i = 0;
+		size_t j = n;
+		for (;;)
+		{
+			do
+				i++;
+			while (i < n && cmp(base + i * w, base, ctx) < 0);
+			do
+				j--;
+			while (cmp(base + j * w, base, ctx) > 0);
+			if (i >= j)
+				break;
+			algo_swap(base + i * w, base + j * w, w);
+		}
+		algo_swap(base, base + j * w, w);
+
+		if (j < n - j - 1)
+		{
+			algo_intro_sort(base, j, w, cmp, ctx, depth);
+			base += (j + 1) * w;
+			n -= j + 1;
+		}
+		else
+		{
+			algo_intro_sort(base + (j + 1) * w, n - j - 1, w, cmp, ctx, depth);
+			n = j;
+		}
+	}
+	algo_insertion_sort(base, n, w, cmp, ctx);
+}
+
+static size_t algo_depth_limit(size_t n)
+{
+	size_t depth = 0;
+
+	while (n > 1)
+	{
+		n >>= 1;
+		depth += 2;
+	}
+	return (depth);
+}
+
+/* Sorts v with cmp. Not stable. */
+static void vector_sort_by(Vector *v, vector_cmp_fn cmp, void *ctx)
+{
+	assert(v != NULL && cmp != NULL && "vector_sort_by: NULL argument");
+
+	if (v->size < 2 || !vector_make_unique(v))
+		return;
+	algo_intro_sort((char *)v->data, v->size, v->elem_size, cmp, ctx, algo_depth_limit(v->size));
+}
+
+/*
+ * Maps keys to unsigned integers with the same ordering (flip the sign bit of
+ * signed ints, flip all bits of negative floats) so radix sort can treat
+ * every key as an unsigned w-byte integer. decode undoes it.
+*/
+#define ALGO_SIGN(T, bits) ((T)1 << ((bits) - 1))
+
+#define ALGO_RADIX_MAP(T, bits, is_float, decode) \
+	for (size_t i = 0; i < n; ++i) \
+	{ \
+		T x; \
+		memcpy(&x, data + i * sizeof(T), sizeof(T)); \
+		if (!(is_float)) \
+			x ^= ALGO_SIGN(T, bits); \
+		else if (!(decode)) \
+			x ^= (x & ALGO_SIGN(T, bits)) ? (T)~(T)0 : ALGO_SIGN(T, bits); \
+		else \
+			x ^= (x & ALGO_SIGN(T, bits)) ? ALGO_SIGN(T, bits) : (T)~(T)0; \
+		memcpy(data + i * sizeof(T), &x, sizeof(T)); \
+	}
+
+static void algo_radix_map(char *data, size_t n, VectorKey key, bool decode)
+{
+	switch (key)
+	{
+		case VECTOR_KEY_I8: ALGO_RADIX_MAP(uint8_t, 8, false, decode) break;
+		case VECTOR_KEY_I16: ALGO_RADIX_MAP(uint16_t, 16, false, decode) break;
+		case VECTOR_KEY_I32: ALGO_RADIX_MAP(uint32_t, 32, false, decode) break;
+		case VECTOR_KEY_I64: ALGO_RADIX_MAP(uint64_t, 64, false, decode) break;
+		case VECTOR_KEY_F32: ALGO_RADIX_MAP(uint32_t, 32, true, decode) break;
+		case VECTOR_KEY_F64: ALGO_RADIX_MAP(uint64_t, 64, true, decode) break;
+		default: break;
+	}
+}
+
+/*
+ * LSD radix sort, one pass per key byte, skipping passes where every
+ * element shares the digit. Needs one n * w scratch block from the vector's
+ * allocator, returns false if it can't get one.
+*/
+static bool algo_radix_sort(Vector *v, VectorKey key)
+{
+	size_t	n = v->size;
+	size_t	w = v->elem_size;
+	char	*data = (char *)v->data;
+	char	*tmp;
+	size_t	count[256];
+
+	// Without free, the scratch block would stay allocated
+	if (!v->alloc.free)
+		return (false);
+	tmp = (char *)v->alloc.alloc(v->alloc.ctx, n * w, v->align);
+	if (!tmp)
+		return (false);
+
+	algo_radix_map(data, n, key, false);
+
+	char *src = data;
+	char *dst = tmp;
+	for (size_t pass = 0; pass < w; ++pass)
+	{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		size_t byte = w - 1 - pass;
+#else
+		size_t byte = pass;
+#endif
+		memset(count, 0, sizeof(count));
+		for (size_t i = 0; i < n; ++i)
+			count[(unsigned char)src[i * w + byte]]++;
+		if (count[(unsigned char)src[byte]] == n)
+			continue;
+
+		size_t sum = 0;
+		for (size_t d = 0; d < 256; ++d)
+		{
+			size_t c = count[d];
+			count[d] = sum;
+			sum += c;
+		}
+		for (size_t i = 0; i < n; ++i)
+		{
+			size_t pos = count[(unsigned char)src[i * w + byte]]++;
+			memcpy(dst + pos * w, src + i * w, w);
+		}
+		char *swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != data)
+		memcpy(data, src, n * w);
+
+	algo_radix_map(data, n, key, true);
+	v->alloc.free(v->alloc.ctx, tmp);
+	return (true);
+}
+
+/*
+ * Sorts a vector of scalar keys in ascending order. Uses radix sort when the
+ * allocator can provide (and free) a scratch block, introsort otherwise.
+ * 		Note: floats are ordered by bit pattern, so -0.0 sorts before 0.0
+ * 		and NaNs end up at the ends.
+*/
+static void vector_sort(Vector *v, VectorKey key)
+{
+	assert(v != NULL && "vector_sort: NULL argument");
+	assert(v->elem_size == algo_key_width(key) && "elem_size does not match key type");
+
+	if (v->size < 2 || v->elem_size != algo_key_width(key) || !vector_make_unique(v))
+		return;
+	if (v->size >= ALGO_RADIX_MIN && algo_radix_sort(v, key))
+		return;
+	vector_sort_by(v, algo_key_cmp, &key);
+}
+
+/* ==================== */
+/* -- Binary search  -- */
+/* ==================== */
+
+/* Index of the first element not less than elem in a vector sorted by cmp. */
+static size_t vector_lower_bound_by(const Vector *v, const void *elem, vector_cmp_fn cmp, void *ctx)
+{
+	assert(v != NULL && elem != NULL && cmp != NULL && "vector_lower_bound_by: NULL argument");
+
+	const char	*data = (const char *)v->data;
+	size_t		lo = 0;
+	size_t		hi = v->size;
+
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		if (cmp(data + mid * v->elem_size, elem, ctx) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo);
+}
+
+#define ALGO_LOWER_BOUND(T) \
+	{ \
+		const T	*d = (const T *)v->data; \
+		T		x; \
+		size_t	lo = 0; \
+		size_t	hi = v->size; \
+		memcpy(&x, elem, sizeof(T)); \
+		while (lo < hi) \
+		{ \
+			size_t mid = lo + (hi - lo) / 2; \
+			if (d[mid] < x) \
+				lo = mid + 1; \
+			else \
+				hi = mid; \
+		} \
+		return (lo); \
+	}
+
+/* Keyed lower bound, compares inline instead of through a function pointer. */
+static size_t vector_lower_bound(const Vector *v, const void *elem, VectorKey key)
+{
+	assert(v != NULL && elem != NULL && "vector_lower_bound: NULL argument");
+	assert(v->elem_size == algo_key_width(key) && "elem_size does not match key type");
+
+	switch (key)
+	{
+		case VECTOR_KEY_U8: ALGO_LOWER_BOUND(uint8_t)
+		case VECTOR_KEY_I8: ALGO_LOWER_BOUND(int8_t)
+		case VECTOR_KEY_U16: ALGO_LOWER_BOUND(uint16_t)
+		case VECTOR_KEY_I16: ALGO_LOWER_BOUND(int16_t)
+		case VECTOR_KEY_U32: ALGO_LOWER_BOUND(uint32_t)
+		case VECTOR_KEY_I32: ALGO_LOWER_BOUND(int32_t)
+		case VECTOR_KEY_U64: ALGO_LOWER_BOUND(uint64_t)
+		case VECTOR_KEY_I64: ALGO_LOWER_BOUND(int64_t)
+		case VECTOR_KEY_F32: ALGO_LOWER_BOUND(float)
+		case VECTOR_KEY_F64: ALGO_LOWER_BOUND(double)
+	}
+	return (v->size);
+}
+
+/* Index of an element equal to elem in a vector sorted by cmp, VECTOR_NPOS if none. */
+static size_t vector_binary_search_by(const Vector *v, const void *elem, vector_cmp_fn cmp, void *ctx)
+{
+	size_t i = vector_lower_bound_by(v, elem, cmp, ctx);
+
+	if (i < v->size && cmp((const char *)v->data + i * v->elem_size, elem, ctx) == 0)
+		return (i);
+	return (VECTOR_NPOS);
+}
+
+static size_t vector_binary_search(const Vector *v, const void *elem, VectorKey key)
+{
+	size_t i = vector_lower_bound(v, elem, key);
+
+	if (i < v->size && algo_key_cmp((const char *)v->data + i * v->elem_size, elem, &key) == 0)
+		return (i);
+	return (VECTOR_NPOS);
+}
+
+/* ===================== */
+/* -- Batch modifiers -- */
+/* ===================== */
+
+/* True if elem matches, ctx is passed through. */
+typedef bool (*vector_pred_fn)(const void *elem, void *ctx);
+
+/*
+ * Keeps the elements for which pred(elem) == keep, preserving their order.
+ * One pass with one memmove per run of kept elements, instead of a memmove
+ * of the whole tail per erased element.
+*/
+static size_t algo_compact(Vector *v, vector_pred_fn pred, void *ctx, bool keep)
+{
+	assert(v != NULL && pred != NULL && "vector_retain: NULL argument");
+
+	if (!vector_make_unique(v))
+		return (0);
+
+	char	*data = (char *)v->data;
+	size_t	w = v->elem_size;
+	size_t	n = v->size;
+	size_t	out = 0;
+	size_t	start = 0;	// first element of the kept run being scanned
+
+	// pred sees each element exactly once, a dropped one flushes the run before it
+	for (size_t i = 0; i <= n; ++i)
+	{
+		if (i < n && pred(data + i * w, ctx) == keep)
+			continue;
+		if (i > start && start != out)
+			memmove(data + out * w, data + start * w, (i - start) * w);
+		out += i - start;
+		start = i + 1;
+	}
+	v->size = out;
+	return (n - out);
+}
+
+/* Keeps only the elements pred accepts, in order. Returns how many were removed. */
+static size_t vector_retain(Vector *v, vector_pred_fn pred, void *ctx)
+{
+	return (algo_compact(v, pred, ctx, true));
+}
+
+/* Removes every element pred accepts, keeping the rest in order. Returns how many were removed. */
+static size_t vector_remove_if(Vector *v, vector_pred_fn pred, void *ctx)
+{
+	return (algo_compact(v, pred, ctx, false));
+}
+
+/*
+ * Merges count elements from src, sorted by cmp, into v, which must be sorted
+ * by cmp too. Works from the back: every gap between existing elements is
+ * opened with one memmove and filled with one memcpy of the batch run that
+ * belongs there, so each existing element moves at most once. Stable, batch
+ * elements go after existing ones that compare equal.
+ * 		Note: src must not point into v.
+*/
+static bool vector_insert_sorted_batch(Vector *v, const void *src, size_t count, vector_cmp_fn cmp, void *ctx)
+{
+	assert(v != NULL && cmp != NULL && (src != NULL || count == 0)
+		&& "vector_insert_sorted_batch: NULL argument");
+
+	size_t	i = v->size;
+	size_t	j = count;
+
+	if (count == 0)
+		return (true);
+	if (count > SIZE_MAX - v->size || !vector_resize_uninit(v, v->size + count))
+		return (false);
+
+	char		*data = (char *)v->data;
+	const char	*in = (const char *)src;
+	size_t		w = v->elem_size;
+	size_t		end = v->size;
+
+	while (j > 0)
+	{
+		// Existing elements greater than the last batch element shift right
+		const char	*x = in + (j - 1) * w;
+		size_t		lo = 0;
+		size_t		hi = i;
+
+		while (lo < hi)
+		{
+			size_t mid = lo + (hi - lo) / 2;
+			if (cmp(x, data + mid * w, ctx) < 0)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		memmove(data + (end - (i - lo)) * w, data + lo * w, (i - lo) * w);
+		end -= i - lo;
+		i = lo;
+
+		// Every batch element not less than data[i - 1] belongs in this gap
+		size_t k = j - 1;
+		while (k > 0 && (i == 0 || cmp(in + (k - 1) * w, data + (i - 1) * w, ctx) >= 0))
+			k--;
+		memcpy(data + (end - (j - k)) * w, in + k * w, (j - k) * w);
+		end -= j - k;
+		j = k;
+	}
+	return (true);
+}
+
+#endif // VECTOR_ALGO_H
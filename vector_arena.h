@@ -12,6 +12,29 @@
    USAGE:
 	 Arena arena = arena_init(PROT_READ | PROT_WRITE);
 	 Vector v = vector_init(arena_allocator(&arena), sizeof(int));
+	 ...
+	 vector_destroy(&v); // rewinds the arena if v's buffer is its last allocation
+
+	 Rewinding needs to know which block is the arena's last allocation, so
+	 map that check before including this header, e.g.
+
+	 #define VECTOR_ARENA_IS_LAST(arena, ptr)	arena_is_last((arena), (ptr))
+
+	 Without it vectors never free, and their buffers stay until the arena
+	 is reset, as before.
+
+	 Temp scopes reclaim everything allocated inside them at once, growth
+	 garbage included. They need the arena's savepoint API, mapped with
+	 three macros before including this header, e.g.
+
+	 #define VECTOR_ARENA_MARK_T			size_t
+	 #define VECTOR_ARENA_MARK(arena)		arena_get_pos(arena)
+	 #define VECTOR_ARENA_REWIND(arena, mark)	arena_set_pos((arena), (mark))
+
+	 ArenaTemp t = arena_temp_begin(&arena);
+	 Vector frame = vector_init(arena_allocator(&arena), sizeof(Cmd));
+	 ...
+	 arena_temp_end(&t);
 */
 
 #ifndef VECTOR_ARENA_H
@@ -34,15 +57,69 @@ static void *arena_realloc_wrapper(void *ctx, void *ptr, size_t old_size, size_t
 	return (arena_realloc((Arena *)ctx, ptr, old_size, new_size));
 }
 
+#ifdef VECTOR_ARENA_IS_LAST
+/*
+ * memarena reallocs the arena's last allocation by moving the offset, so
+ * shrinking the tail block to nothing hands its bytes back to the arena.
+ * Any other block is left alone: reallocing it would make a new empty
+ * allocation on top, and the blocks below could never be rewound again.
+*/
+static void arena_free_wrapper(void *ctx, void *ptr)
+{
+	if (ptr && VECTOR_ARENA_IS_LAST((Arena *)ctx, ptr))
+		arena_realloc((Arena *)ctx, ptr, 0, 0);
+}
+#endif
+
 static Allocator arena_allocator(Arena *arena)
 {
 	Allocator a;
 
 	a.alloc = arena_alloc_wrapper;
 	a.realloc = arena_realloc_wrapper;
+#ifdef VECTOR_ARENA_IS_LAST
+	a.free = arena_free_wrapper;	// rewinds the tail allocation, see above
+#else
 	a.free = NULL;
+#endif
 	a.ctx = arena;
+	a.usable_size = NULL;
+	a.expand_in_place = NULL;	// arena_realloc already extends the tail allocation in place
+	a.alloc_zeroed = NULL;
 	return (a);
 }
 
+/* ==================== */
+/* -- Temp scopes    -- */
+/* ==================== */
+
+#if defined(VECTOR_ARENA_MARK_T) && defined(VECTOR_ARENA_MARK) && defined(VECTOR_ARENA_REWIND)
+
+typedef struct {
+	Arena				*arena;
+	VECTOR_ARENA_MARK_T	mark;
+} ArenaTemp;
+
+/* Remembers the arena's current position. */
+static ArenaTemp arena_temp_begin(Arena *arena)
+{
+	ArenaTemp t;
+
+	t.arena = arena;
+	t.mark = VECTOR_ARENA_MARK(arena);
+	return (t);
+}
+
+/*
+ * Rewinds the arena to where the scope began, releasing every vector buffer
+ * and every block left behind by their growth in one step. Vectors created
+ * inside the scope must not be used afterwards.
+*/
+static void arena_temp_end(ArenaTemp *t)
+{
+	VECTOR_ARENA_REWIND(t->arena, t->mark);
+}
+
+#endif
+
 #endif // VECTOR_ARENA_H
@@ -0,0 +1,226 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_BITS.H v1.0.0
+   -----------------------------------------------------------------------------
+   Packed bit vector, 64 bits per word. Follows the Vector conventions
+   (push/pop/at/clear/reserve, same Allocator) and adds popcount,
+   find-first-set and word-at-a-time AND/OR/XOR between bit vectors.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/vector
+   License: MIT
+   -----------------------------------------------------------------------------
+
+   USAGE:
+	 BitVector seen = bitvec_init(malloc_allocator());
+	 bitvec_resize(&seen, 1000000);		// all bits zero
+	 bitvec_set(&seen, 42, true);
+	 if (bitvec_at(&seen, 42))
+		 ...
+	 size_t hits = bitvec_count(&seen);
+	 size_t first = bitvec_find_first(&seen, 0);	// VECTOR_NPOS if none set
+	 bitvec_and(&seen, &allowed);		// same size required
+	 bitvec_destroy(&seen);
+*/
+
+#ifndef VECTOR_BITS_H
+# define VECTOR_BITS_H
+
+#include "vector.h"
+
+#ifndef VECTOR_NPOS
+# define VECTOR_NPOS ((size_t)-1)	// also defined by vector_algo.h
+#endif
+
+#define BITVEC_WORD_BITS	64
+
+/*
+ * Bits past size in the last word are always kept zero, so counting and
+ * searching can work on whole words without masking.
+*/
+typedef struct {
+	Vector	words;	// uint64_t, (size + 63) / 64 of them
+	size_t	size;	// in bits
+} BitVector;
+
+static inline size_t bitvec_words_for(size_t bits)
+{
+	return (bits / BITVEC_WORD_BITS + (bits % BITVEC_WORD_BITS != 0));
+}
+
+/* ==================== */
+/* -- Initialization -- */
+/* ==================== */
+
+static BitVector bitvec_init(Allocator alloc)
+{
+	BitVector bv;
+
+	bv.words = vector_init(alloc, sizeof(uint64_t));
+	bv.size = 0;
+	return (bv);
+}
+
+/* ==================== */
+/* -- Access         -- */
+/* ==================== */
+
+static inline size_t bitvec_size(const BitVector *bv)
+{
+	return (bv->size);
+}
+
+static inline uint64_t *bitvec_data(const BitVector *bv)
+{
+	return (vector_data_as(&bv->words, uint64_t));
+}
+
+static inline bool bitvec_at(const BitVector *bv, size_t index)
+{
+	assert(index < bv->size && "index out of bounds");
+	return ((bitvec_data(bv)[index / BITVEC_WORD_BITS] >> (index % BITVEC_WORD_BITS)) & 1);
+}
+
+static inline void bitvec_set(BitVector *bv, size_t index, bool value)
+{
+	assert(index < bv->size && "index out of bounds");
+
+	uint64_t *word = &bitvec_data(bv)[index / BITVEC_WORD_BITS];
+	uint64_t bit = (uint64_t)1 << (index % BITVEC_WORD_BITS);
+
+	*word = value ? (*word | bit) : (*word & ~bit);
+}
+
+/* ==================== */
+/* -- Modifiers      -- */
+/* ==================== */
+
+static bool bitvec_reserve(BitVector *bv, size_t bits)
+{
+	assert(bv != NULL && "bitvec_reserve: NULL argument");
+	return (vector_reserve(&bv->words, bitvec_words_for(bits)));
+}
+
+static bool bitvec_push(BitVector *bv, bool value)
+{
+	assert(bv != NULL && "bitvec_push: NULL argument");
+
+	if (bv->size % BITVEC_WORD_BITS == 0)
+	{
+		uint64_t zero = 0;
+		if (!vector_push(&bv->words, &zero))
+			return (false);
+	}
+	bv->size++;
+	if (value)
+		bitvec_set(bv, bv->size - 1, true);
+	return (true);
+}
+
+static bool bitvec_pop(BitVector *bv)
+{
+	assert(bv != NULL && bv->size > 0 && "vector is empty");
+
+	if (!bv || bv->size == 0)
+		return (false);
+	bitvec_set(bv, bv->size - 1, false);
+	bv->size--;
+	if (bv->size % BITVEC_WORD_BITS == 0)
+		vector_pop(&bv->words);
+	return (true);
+}
+
+/* Sets the size to bits, new bits are zero. */
+static bool bitvec_resize(BitVector *bv, size_t bits)
+{
+	assert(bv != NULL && "bitvec_resize: NULL argument");
+
+	if (!vector_resize(&bv->words, bitvec_words_for(bits)))
+		return (false);
+	bv->size = bits;
+	// Shrinking may leave stale bits in the new last word
+	if (bits % BITVEC_WORD_BITS)
+		bitvec_data(bv)[bits / BITVEC_WORD_BITS] &= ((uint64_t)1 << (bits % BITVEC_WORD_BITS)) - 1;
+	return (true);
+}
+
+static void bitvec_clear(BitVector *bv)
+{
+	if (!bv)
+		return;
+	vector_clear(&bv->words);
+	bv->size = 0;
+}
+
+static void bitvec_destroy(BitVector *bv)
+{
+	if (!bv)
+		return;
+	vector_destroy(&bv->words);
+	bv->size = 0;
+}
+
+/* ==================== */
+/* -- Bulk queries   -- */
+/* ==================== */
+
+/* Number of set bits. */
+static size_t bitvec_count(const BitVector *bv)
+{
+	const uint64_t	*w = bitvec_data(bv);
+	size_t			n = bv->words.size;
+	size_t			count = 0;
+
+	for (size_t i = 0; i < n; ++i)
+		count += (size_t)__builtin_popcountll(w[i]);
+	return (count);
+}
+
+/* Index of the first set bit at or after from, VECTOR_NPOS if there is none. */
+static size_t bitvec_find_first(const BitVector *bv, size_t from)
+{
+	if (from >= bv->size)
+		return (VECTOR_NPOS);
+
+	const uint64_t	*w = bitvec_data(bv);
+	size_t			i = from / BITVEC_WORD_BITS;
+	uint64_t		word = w[i] & (~(uint64_t)0 << (from % BITVEC_WORD_BITS));
+
+	for (;;)
+	{
+		if (word)
+			return (i * BITVEC_WORD_BITS + (size_t)__builtin_ctzll(word));
+		if (++i >= bv->words.size)
+			return (VECTOR_NPOS);
+		word = w[i];
+	}
+}
+
+/* ==================== */
+/* -- Word-wise ops  -- */
+/* ==================== */
+
+/*
+ * dst op= src, a full word at a time. Both must have the same size. None of
+ * the three can set a bit past size, so the zero tail holds.
+*/
+#define BITVEC_WORDWISE_OP(name, expr) \
+	static bool name(BitVector *dst, const BitVector *src) \
+	{ \
+		assert(dst != NULL && src != NULL && dst->size == src->size && "bit vector size mismatch"); \
+		if (!dst || !src || dst->size != src->size) \
+			return (false); \
+		uint64_t		*d = bitvec_data(dst); \
+		const uint64_t	*s = bitvec_data(src); \
+		for (size_t i = 0; i < dst->words.size; ++i) \
+			d[i] = (expr); \
+		return (true); \
+	}
+
+BITVEC_WORDWISE_OP(bitvec_and, d[i] & s[i])
+BITVEC_WORDWISE_OP(bitvec_or, d[i] | s[i])
+BITVEC_WORDWISE_OP(bitvec_xor, d[i] ^ s[i])
+
+#undef BITVEC_WORDWISE_OP
+
+#endif // VECTOR_BITS_H
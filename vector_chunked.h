@@ -0,0 +1,179 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_CHUNKED.H v1.0.0
+   -----------------------------------------------------------------------------
+   Segmented vector with stable element addresses. Elements live in fixed
+   power-of-two sized blocks reached through a block table, so indexing is
+   O(1), growing never copies elements and pointers to them stay valid until
+   the element is removed.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/vector
+   License: MIT
+   -----------------------------------------------------------------------------
+
+   USAGE:
+	 ChunkedVector cv = chunked_init(malloc_allocator(), sizeof(Node));
+	 chunked_push(&cv, &node);
+	 Node *n = chunked_ptr(&cv, 0);		// stays valid across pushes
+	 Node copy = chunked_at(&cv, Node, 0);
+	 chunked_swap_pop(&cv, 0);
+	 chunked_destroy(&cv);
+*/
+
+#ifndef VECTOR_CHUNKED_H
+# define VECTOR_CHUNKED_H
+
+#include "vector.h"
+
+#ifndef CHUNKED_BLOCK_BYTES
+# define CHUNKED_BLOCK_BYTES	(16 * 1024)	// target block size, rounded down to a power-of-two element count
+#endif
+
+typedef struct {
+	Vector		blocks;			// block pointers, only this table is ever reallocated
+	size_t		size;
+	size_t		elem_size;
+	size_t		block_shift;	// log2 of elements per block
+	Allocator	alloc;
+} ChunkedVector;
+
+/* ==================== */
+/* -- Initialization -- */
+/* ==================== */
+
+static ChunkedVector chunked_init_block(Allocator alloc, size_t elem_size, size_t block_shift)
+{
+	assert(alloc.alloc != NULL && "allocator must provide alloc function");
+	assert(elem_size > 0 && "elem_size must be > 0");
+	assert(block_shift < sizeof(size_t) * 8 && "block too large");
+
+	ChunkedVector cv;
+	cv.blocks = vector_init(alloc, sizeof(void *));
+	cv.size = 0;
+	cv.elem_size = elem_size;
+	cv.block_shift = block_shift;
+	cv.alloc = alloc;
+	return (cv);
+}
+
+static ChunkedVector chunked_init(Allocator alloc, size_t elem_size)
+{
+	size_t shift = 0;
+
+	while (((size_t)2 << shift) * elem_size <= CHUNKED_BLOCK_BYTES)
+		shift++;
+	return (chunked_init_block(alloc, elem_size, shift));
+}
+
+/* ==================== */
+/* -- Access         -- */
+/* ==================== */
+
+static inline size_t chunked_capacity(const ChunkedVector *cv)
+{
+	return (cv->blocks.size << cv->block_shift);
+}
+
+/* Pointer to element index, valid until that element is popped or erased. */
+static inline void *chunked_ptr(const ChunkedVector *cv, size_t index)
+{
+	assert(index < cv->size && "index out of bounds");
+
+	char **blocks = vector_data_as(&cv->blocks, char *);
+	size_t mask = ((size_t)1 << cv->block_shift) - 1;
+
+	return (blocks[index >> cv->block_shift] + (index & mask) * cv->elem_size);
+}
+
+/* Node n = chunked_at(&cv, Node, 0); */
+#define chunked_at(cv, T, idx) (*(T *)chunked_ptr((cv), (idx)))
+
+/* ==================== */
+/* -- Modifiers      -- */
+/* ==================== */
+
+/* Adds blocks until at least new_capacity elements fit. Existing blocks never move. */
+static bool chunked_reserve(ChunkedVector *cv, size_t new_capacity)
+{
+	assert(cv != NULL && "chunked_reserve: NULL argument");
+
+	size_t block_bytes = ((size_t)1 << cv->block_shift) * cv->elem_size;
+	size_t needed = (new_capacity >> cv->block_shift)
+		+ ((new_capacity & (((size_t)1 << cv->block_shift) - 1)) != 0);
+
+	if (needed <= cv->blocks.size)
+		return (true);
+	if (!vector_reserve(&cv->blocks, needed))
+		return (false);
+	while (cv->blocks.size < needed)
+	{
+		void *block = cv->alloc.alloc(cv->alloc.ctx, block_bytes, 0);
+		if (!block)
+		{
+			assert(0 && "chunked_reserve: alloc failed");
+			return (false);
+		}
+		vector_push(&cv->blocks, &block);
+	}
+	return (true);
+}
+
+static bool chunked_push(ChunkedVector *cv, const void *elem)
+{
+	assert(cv != NULL && elem != NULL && "chunked_push: NULL argument");
+
+	if (cv->size == chunked_capacity(cv) && !chunked_reserve(cv, cv->size + 1))
+		return (false);
+	cv->size++;
+	memcpy(chunked_ptr(cv, cv->size - 1), elem, cv->elem_size);
+	return (true);
+}
+
+static bool chunked_pop(ChunkedVector *cv)
+{
+	assert(cv != NULL && cv->size > 0 && "vector is empty");
+
+	if (!cv || cv->size == 0)
+		return (false);
+	cv->size--;
+	return (true);
+}
+
+/* O(1) removal, moves the last element into index. Does NOT preserve order. */
+static bool chunked_swap_pop(ChunkedVector *cv, size_t index)
+{
+	assert(cv != NULL && index < cv->size && "index out of bounds");
+
+	if (!cv || index >= cv->size)
+		return (false);
+	if (index != cv->size - 1)
+		memcpy(chunked_ptr(cv, index), chunked_ptr(cv, cv->size - 1), cv->elem_size);
+	cv->size--;
+	return (true);
+}
+
+/* Keeps the blocks around for reuse, like vector_clear keeps capacity. */
+static void chunked_clear(ChunkedVector *cv)
+{
+	if (cv)
+		cv->size = 0;
+}
+
+static void chunked_destroy(ChunkedVector *cv)
+{
+	if (!cv)
+		return;
+
+	if (cv->alloc.free)
+	{
+		for (size_t i = 0; i < cv->blocks.size; ++i)
+			cv->alloc.free(cv->alloc.ctx, vector_data_as(&cv->blocks, void *)[i]);
+	}
+	vector_destroy(&cv->blocks);
+	cv->size = 0;
+	cv->elem_size = 0;
+	cv->block_shift = 0;
+}
+
+#endif // VECTOR_CHUNKED_H
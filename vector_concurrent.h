@@ -0,0 +1,232 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_CONCURRENT.H v1.0.0
+   -----------------------------------------------------------------------------
+   Lock-free multi-producer append vector. Slots are handed out with an
+   atomic fetch-add, and storage grows by chaining segments of doubling size
+   instead of reallocating, so elements never move once written.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/vector
+   License: MIT
+   -----------------------------------------------------------------------------
+
+   USAGE:
+	 ConcurrentVector cv = cvector_init(malloc_allocator(), sizeof(Event));
+
+	 // From any number of threads
+	 cvector_push(&cv, &event);
+
+	 // Once every producer is done (e.g. joined)
+	 Vector events;
+	 cvector_freeze(&cv, &events);	// compacts into a regular Vector
+
+	 The allocator is called by whichever thread first reaches a new segment,
+	 so it has to be thread-safe (malloc is, an arena is not). Reading with
+	 cvector_at, cvector_snapshot or cvector_freeze is only safe for slots
+	 whose push has returned.
+
+	 If a segment can't be allocated, every push that lands in it returns
+	 false and the segment is left out of snapshots, so they hold exactly
+	 the elements whose push returned true.
+*/
+
+#ifndef VECTOR_CONCURRENT_H
+# define VECTOR_CONCURRENT_H
+
+#include "vector.h"
+
+#ifndef CVECTOR_FIRST_SHIFT
+# define CVECTOR_FIRST_SHIFT	6	// first segment holds 64 elements
+#endif
+#define CVECTOR_MAX_SEGMENTS	(64 - CVECTOR_FIRST_SHIFT)
+#define CVECTOR_ALLOCATING		((void *)1)	// segment claimed, allocation in progress
+#define CVECTOR_FAILED			((void *)2)	// allocation failed, its slots stay empty
+
+typedef struct {
+	void		*segments[CVECTOR_MAX_SEGMENTS];	// segment s holds 64 << s elements
+	size_t		size;		// slots handed out, atomic
+	size_t		elem_size;
+	Allocator	alloc;
+} ConcurrentVector;
+
+static ConcurrentVector cvector_init(Allocator alloc, size_t elem_size)
+{
+	assert(alloc.alloc != NULL && "allocator must provide alloc function");
+	assert(elem_size > 0 && "elem_size must be > 0");
+
+	ConcurrentVector cv;
+	memset(&cv, 0, sizeof(cv));
+	cv.elem_size = elem_size;
+	cv.alloc = alloc;
+	return (cv);
+}
+
+static inline size_t cvector_segment_capacity(size_t segment)
+{
+	return ((size_t)1 << (segment + CVECTOR_FIRST_SHIFT));
+}
+
+/* Segments double in size, so index i lives in segment floor(log2(i / 64 + 1)). */
+static inline size_t cvector_segment_of(size_t index, size_t *offset)
+{
+	size_t q = (index >> CVECTOR_FIRST_SHIFT) + 1;
+	size_t segment = (size_t)(63 - __builtin_clzll((unsigned long long)q));
+
+	*offset = index - ((((size_t)1 << segment) - 1) << CVECTOR_FIRST_SHIFT);
+	return (segment);
+}
+
+static inline bool cvector_segment_live(const void *seg)
+{
+	return (seg && seg != CVECTOR_ALLOCATING && seg != CVECTOR_FAILED);
+}
+
+/*
+ * Returns segment s, allocating it if needed. One thread claims the empty
+ * segment with a CAS and allocates it, the others spin until it's published.
+ * A failed allocation marks the segment failed rather than empty: slots in
+ * it were already handed out, and a later retry would leave those unwritten
+ * inside a live segment.
+*/
+static char *cvector_segment(ConcurrentVector *cv, size_t s)
+{
+	void *seg = __atomic_load_n(&cv->segments[s], __ATOMIC_ACQUIRE);
+
+	if (seg == CVECTOR_FAILED)
+		return (NULL);
+	if (seg && seg != CVECTOR_ALLOCATING)
+		return ((char *)seg);
+
+	void *expected = NULL;
+	if (__atomic_compare_exchange_n(&cv->segments[s], &expected, CVECTOR_ALLOCATING,
+		false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		seg = cv->alloc.alloc(cv->alloc.ctx, cvector_segment_capacity(s) * cv->elem_size, 0);
+		if (!seg)
+		{
+			__atomic_store_n(&cv->segments[s], CVECTOR_FAILED, __ATOMIC_RELEASE);
+			return (NULL);
+		}
+		__atomic_store_n(&cv->segments[s], seg, __ATOMIC_RELEASE);
+		return ((char *)seg);
+	}
+	while ((seg = __atomic_load_n(&cv->segments[s], __ATOMIC_ACQUIRE)) == CVECTOR_ALLOCATING)
+		;
+	return (seg == CVECTOR_FAILED ? NULL : (char *)seg);
+}
+
+/*
+ * Appends elem, safe to call from any number of threads at once.
+ * 		Note: if a segment allocation fails, push returns false for every
+ * 		slot in that segment, and freeze/snapshot skip it.
+*/
+static bool cvector_push(ConcurrentVector *cv, const void *elem)
+{
+	assert(cv != NULL && elem != NULL && "cvector_push: NULL argument");
+
+	size_t	index = __atomic_fetch_add(&cv->size, 1, __ATOMIC_RELAXED);
+	size_t	offset;
+	size_t	s = cvector_segment_of(index, &offset);
+
+	if (s >= CVECTOR_MAX_SEGMENTS)
+		return (false);
+
+	char *seg = cvector_segment(cv, s);
+	if (!seg)
+	{
+		assert(0 && "cvector_push: segment alloc failed");
+		return (false);
+	}
+	memcpy(seg + offset * cv->elem_size, elem, cv->elem_size);
+	return (true);
+}
+
+static size_t cvector_size(const ConcurrentVector *cv)
+{
+	return (__atomic_load_n(&cv->size, __ATOMIC_ACQUIRE));
+}
+
+/* Pointer to element index, stable for the lifetime of the vector. */
+static void *cvector_at(ConcurrentVector *cv, size_t index)
+{
+	assert(index < cvector_size(cv) && "index out of bounds");
+
+	size_t	offset;
+	size_t	s = cvector_segment_of(index, &offset);
+	char	*seg = (char *)__atomic_load_n(&cv->segments[s], __ATOMIC_ACQUIRE);
+
+	if (!cvector_segment_live(seg))
+		return (NULL);
+	return (seg + offset * cv->elem_size);
+}
+
+/*
+ * Appends every element to out, reserving once and copying one segment at a
+ * time. Failed segments are skipped. On failure out is left as it was.
+*/
+static bool cvector_snapshot(const ConcurrentVector *cv, Vector *out)
+{
+	assert(cv != NULL && out != NULL && out->elem_size == cv->elem_size
+		&& "cvector_snapshot: invalid argument");
+
+	size_t	size = __atomic_load_n(&cv->size, __ATOMIC_ACQUIRE);
+	size_t	old_size = out->size;
+	size_t	live = 0;
+
+	for (size_t s = 0, left = size; left > 0 && s < CVECTOR_MAX_SEGMENTS; ++s)
+	{
+		size_t n = cvector_segment_capacity(s) < left ? cvector_segment_capacity(s) : left;
+		if (cvector_segment_live(__atomic_load_n(&cv->segments[s], __ATOMIC_ACQUIRE)))
+			live += n;
+		left -= n;
+	}
+	if (live > SIZE_MAX - out->size || !vector_reserve(out, out->size + live))
+		return (false);
+	for (size_t s = 0; size > 0 && s < CVECTOR_MAX_SEGMENTS; ++s)
+	{
+		size_t	n = cvector_segment_capacity(s) < size ? cvector_segment_capacity(s) : size;
+		void	*seg = __atomic_load_n(&cv->segments[s], __ATOMIC_ACQUIRE);
+
+		if (cvector_segment_live(seg) && !vector_push_n(out, seg, n))
+		{
+			out->size = old_size;
+			return (false);
+		}
+		size -= n;
+	}
+	return (true);
+}
+
+static void cvector_destroy(ConcurrentVector *cv)
+{
+	if (!cv)
+		return;
+
+	for (size_t s = 0; s < CVECTOR_MAX_SEGMENTS; ++s)
+	{
+		if (cvector_segment_live(cv->segments[s]) && cv->alloc.free)
+			cv->alloc.free(cv->alloc.ctx, cv->segments[s]);
+	}
+	memset(cv, 0, sizeof(*cv));
+}
+
+/*
+ * Compacts the segments into a new Vector using the same allocator, then
+ * destroys the concurrent vector. Call it once all producers are done.
+*/
+static bool cvector_freeze(ConcurrentVector *cv, Vector *out)
+{
+	assert(cv != NULL && out != NULL && "cvector_freeze: NULL argument");
+
+	*out = vector_init(cv->alloc, cv->elem_size);
+	if (!cvector_snapshot(cv, out))
+	{
+		vector_destroy(out);
+		return (false);
+	}
+	cvector_destroy(cv);
+	return (true);
+}
+
+#endif // VECTOR_CONCURRENT_H
@@ -0,0 +1,265 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_DEQUE.H v1.0.0
+   -----------------------------------------------------------------------------
+   Double-ended queue on a ring buffer. The elements wrap around the end of
+   one Vector buffer from a head offset, so pushing and popping at either end
+   is O(1) with no memmove, e.g. for a FIFO work queue.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/vector
+   License: MIT
+   -----------------------------------------------------------------------------
+
+   USAGE:
+	 VectorDeque q = deque_init(malloc_allocator(), sizeof(Task));
+	 deque_push_back(&q, &task);
+	 Task next = deque_front(&q, Task);
+	 deque_pop_front(&q);
+
+	 size_t n = deque_size(&q);
+	 Task *all = deque_linearize(&q);	// one contiguous span for batch work
+	 run_batch(all, n);
+
+	 deque_destroy(&q);
+
+	 The buffer is a regular Vector (q.buf) and grows by its growth policy
+	 through the same Allocator, but its elements start at q.head and wrap,
+	 so don't pass it to the vector_* modifiers.
+*/
+
+#ifndef VECTOR_DEQUE_H
+# define VECTOR_DEQUE_H
+
+#include "vector.h"
+
+typedef struct {
+	Vector	buf;	// buf.size is the element count, buf.capacity the ring length
+	size_t	head;	// index in buf of the front element
+} VectorDeque;
+
+/* Task t = deque_at(&q, Task, 0); */
+#define deque_at(d, T, idx) (*(T *)deque_ptr((d), (idx)))
+
+/* Task first = deque_front(&q, Task); */
+#define deque_front(d, T) ( \
+	assert((d)->buf.size > 0 && "deque empty"), \
+	deque_at(d, T, 0) \
+)
+
+/* Task last = deque_back(&q, Task); */
+#define deque_back(d, T) ( \
+	assert((d)->buf.size > 0 && "deque empty"), \
+	deque_at(d, T, (d)->buf.size - 1) \
+)
+
+/* ==================== */
+/* -- Initialization -- */
+/* ==================== */
+
+static VectorDeque deque_init_aligned(Allocator alloc, size_t elem_size, size_t align)
+{
+	VectorDeque d;
+
+	d.buf = vector_init_aligned(alloc, elem_size, align);
+	d.head = 0;
+	return (d);
+}
+
+static VectorDeque deque_init(Allocator alloc, size_t elem_size)
+{
+	return (deque_init_aligned(alloc, elem_size, 0));
+}
+
+/* ==================== */
+/* -- Access         -- */
+/* ==================== */
+
+static inline size_t deque_size(const VectorDeque *d)
+{
+	return (d->buf.size);
+}
+
+/* Buffer slot of logical index i, i <= capacity. */
+static inline size_t deque_slot(const VectorDeque *d, size_t i)
+{
+	size_t slot = d->head + i;
+
+	return (slot >= d->buf.capacity ? slot - d->buf.capacity : slot);
+}
+
+static inline void *deque_ptr(const VectorDeque *d, size_t index)
+{
+	assert(index < d->buf.size && "index out of bounds");
+	return ((char *)d->buf.data + deque_slot(d, index) * d->buf.elem_size);
+}
+
+/* ==================== */
+/* -- Modifiers      -- */
+/* ==================== */
+
+/*
+ * After the buffer grew from old_capacity with its old layout kept at the
+ * start, moves whichever part of a wrapped ring is cheaper so the elements
+ * are in order again: the wrapped-around back into the new space, or the
+ * front up against the new end.
+*/
+static void deque_unwrap_grown(VectorDeque *d, size_t old_capacity)
+{
+	char	*data = (char *)d->buf.data;
+	size_t	es = d->buf.elem_size;
+	size_t	front = old_capacity - d->head;
+
+	if (d->head + d->buf.size <= old_capacity)
+		return;
+
+	size_t back = d->buf.size - front;	// elements wrapped around to [0, back)
+	if (back <= front && back <= d->buf.capacity - old_capacity)
+		memcpy(data + old_capacity * es, data, back * es);
+	else
+	{
+		size_t head = d->buf.capacity - front;
+		memmove(data + head * es, data + d->head * es, front * es);
+		d->head = head;
+	}
+}
+
+/*
+ * Grows to new_capacity, or by the growth policy if it's 0, with the whole
+ * old ring counted as in use so the vector copies (or reallocs) every slot,
+ * then restores the ring order.
+*/
+static bool deque_grow(VectorDeque *d, size_t new_capacity)
+{
+	size_t size = d->buf.size;
+	size_t old_capacity = d->buf.capacity;
+
+	d->buf.size = d->buf.capacity;
+	bool ok = new_capacity ? vector_reserve(&d->buf, new_capacity) : vector_grow(&d->buf);
+	d->buf.size = size;
+	if (ok)
+		deque_unwrap_grown(d, old_capacity);
+	return (ok);
+}
+
+static bool deque_reserve(VectorDeque *d, size_t new_capacity)
+{
+	assert(d != NULL && "deque_reserve: NULL argument");
+
+	if (new_capacity <= d->buf.capacity)
+		return (true);
+	return (deque_grow(d, new_capacity));
+}
+
+static bool deque_push_back(VectorDeque *d, const void *elem)
+{
+	assert(d != NULL && elem != NULL && "deque_push_back: NULL argument");
+
+	if (d->buf.size == d->buf.capacity && !deque_grow(d, 0))
+		return (false);
+	memcpy((char *)d->buf.data + deque_slot(d, d->buf.size) * d->buf.elem_size,
+		elem, d->buf.elem_size);
+	d->buf.size++;
+	return (true);
+}
+
+static bool deque_push_front(VectorDeque *d, const void *elem)
+{
+	assert(d != NULL && elem != NULL && "deque_push_front: NULL argument");
+
+	if (d->buf.size == d->buf.capacity && !deque_grow(d, 0))
+		return (false);
+	d->head = d->head == 0 ? d->buf.capacity - 1 : d->head - 1;
+	memcpy((char *)d->buf.data + d->head * d->buf.elem_size, elem, d->buf.elem_size);
+	d->buf.size++;
+	return (true);
+}
+
+static bool deque_pop_back(VectorDeque *d)
+{
+	assert(d != NULL && d->buf.size > 0 && "deque is empty");
+
+	if (!d || d->buf.size == 0)
+		return (false);
+	d->buf.size--;
+	return (true);
+}
+
+static bool deque_pop_front(VectorDeque *d)
+{
+	assert(d != NULL && d->buf.size > 0 && "deque is empty");
+
+	if (!d || d->buf.size == 0)
+		return (false);
+	d->head = deque_slot(d, 1);
+	d->buf.size--;
+	if (d->buf.size == 0)
+		d->head = 0;
+	return (true);
+}
+
+/* Reverses len bytes in place. */
+static void deque_reverse_bytes(char *p, size_t len)
+{
+	for (size_t i = 0, j = len; i + 1 < j; ++i, --j)
+	{
+		char tmp = p[i];
+		p[i] = p[j - 1];
+		p[j - 1] = tmp;
+	}
+}
+
+/*
+ * Pointer to the elements as one contiguous array of deque_size elements,
+ * valid until the next push. A ring that doesn't wrap is returned as is,
+ * a wrapped one is rearranged in place to start at slot 0, no allocation.
+*/
+static void *deque_linearize(VectorDeque *d)
+{
+	assert(d != NULL && "deque_linearize: NULL argument");
+
+	char	*data = (char *)d->buf.data;
+	size_t	es = d->buf.elem_size;
+	size_t	front = d->buf.capacity - d->head;
+
+	if (d->buf.size == 0)
+		return (data);
+	if (d->head + d->buf.size <= d->buf.capacity)
+		return (data + d->head * es);
+
+	size_t back = d->buf.size - front;
+	if (front <= d->head - back)
+	{
+		// The front fits in the gap: slide the back up behind it, copy it down
+		memmove(data + front * es, data, back * es);
+		memcpy(data, data + d->head * es, front * es);
+	}
+	else
+	{
+		// Rotate the whole buffer left by head, three reversals
+		deque_reverse_bytes(data, d->head * es);
+		deque_reverse_bytes(data + d->head * es, front * es);
+		deque_reverse_bytes(data, d->buf.capacity * es);
+	}
+	d->head = 0;
+	return (data);
+}
+
+/* Keeps the buffer for reuse, like vector_clear keeps capacity. */
+static void deque_clear(VectorDeque *d)
+{
+	if (!d)
+		return;
+	d->buf.size = 0;
+	d->head = 0;
+}
+
+static void deque_destroy(VectorDeque *d)
+{
+	if (!d)
+		return;
+	vector_destroy(&d->buf);
+	d->head = 0;
+}
+
+#endif // VECTOR_DEQUE_H
@@ -0,0 +1,353 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_FILE.H v1.0.0
+   -----------------------------------------------------------------------------
+   Saving vectors of plain-old-data to disk and mapping them back without a
+   copy. vector_map points data straight into a read-only mmap of the file,
+   so loading costs nothing up front and pages fault in as they're touched.
+   vector_read streams records from a pipe or socket straight into the
+   vector's spare capacity.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/vector
+   License: MIT
+   -----------------------------------------------------------------------------
+
+   USAGE:
+	 vector_save(&v, "points.vec");
+
+	 Vector points;
+	 if (vector_map("points.vec", &points))
+	 {
+		 Point p = vector_at(&points, Point, 0);
+		 ...
+		 vector_destroy(&points); // unmaps the file
+	 }
+
+	 // Ingest fixed-size records from a socket, no staging buffer
+	 while ((n = vector_read(&records, sock)) > 0)
+		 parse_new(&records, n);
+
+	 // Same from a non-blocking socket, e.g. when epoll says it's readable
+	 size_t pending = 0;		// per connection, survives between events
+	 if ((n = vector_read_nonblock(&records, sock, &pending)) > 0)
+		 parse_new(&records, n);
+
+	 A mapped vector is copy-on-write and fixed-capacity: writes, erase, sort
+	 and friends work on private copies of the pages they touch and never
+	 reach the file, and anything that needs more capacity returns false.
+	 To grow it, vector_append it into a regular vector first. The file is
+	 raw memory plus a small header, so it is only readable on a machine
+	 with the same endianness and type layout.
+*/
+
+#ifndef VECTOR_FILE_H
+# define VECTOR_FILE_H
+
+#include "vector.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define VECTOR_FILE_MAGIC	"VECTOR\0\1"
+#define VECTOR_FILE_VERSION	1
+
+#ifndef VECTOR_FILE_ALIGN
+# define VECTOR_FILE_ALIGN	64	// minimum alignment of the data in the file
+#endif
+
+typedef struct {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	reserved;
+	uint64_t	elem_size;
+	uint64_t	count;
+	uint64_t	align;
+	uint64_t	data_offset;	// from the start of the file, multiple of the alignment
+} VectorFileHeader;
+
+/* ==================== */
+/* -- Writing        -- */
+/* ==================== */
+
+/* 0 or a power of two no bigger than a page, so a mapping can honour it. */
+static bool vector_file_align_valid(uint64_t align)
+{
+	return ((align & (align - 1)) == 0 && align <= (uint64_t)sysconf(_SC_PAGESIZE));
+}
+
+static bool vector_file_write_all(int fd, const void *buf, size_t len)
+{
+	const char *p = (const char *)buf;
+
+	while (len > 0)
+	{
+		ssize_t n = write(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return (false);
+		p += n;
+		len -= (size_t)n;
+	}
+	return (true);
+}
+
+/* Writes the header followed by the elements to fd, starting at its current offset. */
+static bool vector_write(const Vector *v, int fd)
+{
+	assert(v != NULL && v->elem_size > 0 && "vector_write: invalid vector");
+
+	static const char	zeros[VECTOR_FILE_ALIGN] = {0};
+	VectorFileHeader	h;
+	size_t				align = v->align > VECTOR_FILE_ALIGN ? v->align : VECTOR_FILE_ALIGN;
+
+	// vector_map would refuse the file anyway
+	if (!vector_file_align_valid(v->align))
+		return (false);
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, VECTOR_FILE_MAGIC, sizeof(h.magic));
+	h.version = VECTOR_FILE_VERSION;
+	h.elem_size = v->elem_size;
+	h.count = v->size;
+	h.align = v->align;
+	h.data_offset = (sizeof(h) + align - 1) & ~(uint64_t)(align - 1);
+
+	if (!vector_file_write_all(fd, &h, sizeof(h)))
+		return (false);
+	for (size_t pad = (size_t)h.data_offset - sizeof(h); pad > 0; )
+	{
+		size_t n = pad < sizeof(zeros) ? pad : sizeof(zeros);
+		if (!vector_file_write_all(fd, zeros, n))
+			return (false);
+		pad -= n;
+	}
+	return (vector_file_write_all(fd, v->data, v->size * v->elem_size));
+}
+
+/* Creates or truncates path and writes the vector to it. */
+static bool vector_save(const Vector *v, const char *path)
+{
+	assert(path != NULL && "vector_save: NULL path");
+
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return (false);
+
+	bool ok = vector_write(v, fd);
+	if (close(fd) != 0)
+		ok = false;
+	return (ok);
+}
+
+/* ==================== */
+/* -- Streaming      -- */
+/* ==================== */
+
+/* True unless fd is valid and O_NONBLOCK. */
+static bool vector_file_blocking(int fd)
+{
+	int flags = fcntl(fd, F_GETFL);
+
+	return (flags == -1 || !(flags & O_NONBLOCK));
+}
+
+/*
+ * Core of vector_read and vector_read_nonblock. pending is NULL for a
+ * blocking fd, otherwise it holds the bytes of a partial element already
+ * sitting right past v->size, and is updated on return.
+*/
+static ssize_t vector_file_read(Vector *v, int fd, size_t *pending)
+{
+	// A full vector would grow and leave the pending bytes behind
+	assert((!pending || *pending == 0 || (*pending < v->elem_size && v->size < v->capacity))
+		&& "vector_read_nonblock: v changed with a partial element pending");
+
+	size_t	spare;
+	char	*dst = (char *)vector_spare(v, &spare);
+	size_t	want = spare * v->elem_size;
+	size_t	got = pending ? *pending : 0;
+	ssize_t	n = 0;
+
+	if (!dst)
+	{
+		errno = ENOMEM;
+		return (-1);
+	}
+	while (got == 0 || got % v->elem_size != 0)
+	{
+		n = read(fd, dst + got, want - got);
+		if (n < 0 && errno == EINTR && !pending)
+			continue;
+		if (n <= 0)
+			break;
+		got += (size_t)n;
+	}
+
+	size_t whole = got / v->elem_size;
+	vector_commit(v, whole);
+	if (pending)
+		*pending = got - whole * v->elem_size;
+	if (whole == 0 && n < 0)
+		return (-1);
+	return ((ssize_t)whole);
+}
+
+/*
+ * Reads from a blocking fd straight into the spare capacity of v, growing
+ * it first if it's full, and commits the whole elements read. A read that
+ * stops partway through an element keeps reading until it's complete, so
+ * records never split across calls. Returns the number of elements
+ * appended, 0 at end of file or -1 on error with errno set. A partial
+ * element at end of file is dropped. Use vector_read_nonblock on an
+ * O_NONBLOCK fd.
+*/
+static ssize_t vector_read(Vector *v, int fd)
+{
+	assert(v != NULL && "vector_read: NULL vector");
+	assert(vector_file_blocking(fd) && "vector_read: fd is non-blocking, see vector_read_nonblock");
+
+	return (vector_file_read(v, fd, NULL));
+}
+
+/*
+ * vector_read for a non-blocking fd. Returns once read reports EAGAIN,
+ * EWOULDBLOCK or EINTR, with the whole elements so far committed, or -1 if
+ * none was. The bytes of an element cut off there stay in v's spare
+ * capacity and *pending (0 before the first call) counts them, so the next
+ * call carries on where this one stopped and no record is lost or shifted.
+ * Don't modify v in between while *pending is non-zero. *pending still
+ * being non-zero at end of file means the stream ended mid-element.
+*/
+static ssize_t vector_read_nonblock(Vector *v, int fd, size_t *pending)
+{
+	assert(v != NULL && pending != NULL && "vector_read_nonblock: NULL argument");
+
+	return (vector_file_read(v, fd, pending));
+}
+
+/* Appends everything up to end of file, e.g. a whole pipe or socket stream. */
+static bool vector_read_all(Vector *v, int fd)
+{
+	ssize_t n;
+
+	while ((n = vector_read(v, fd)) > 0)
+		;
+	return (n == 0);
+}
+
+/* ==================== */
+/* -- Mapping        -- */
+/* ==================== */
+
+/*
+ * Allocator of a mapped vector. ctx is the start of the mapping, whose header
+ * says how long it is, so no state lives outside the file itself. It never
+ * hands out memory, so a mapped vector can't grow.
+*/
+static void *vector_file_alloc(void *ctx, size_t size, size_t align)
+{
+	(void)ctx;
+	(void)size;
+	(void)align;
+	return (NULL);
+}
+
+static void *vector_file_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align)
+{
+	(void)ctx;
+	(void)ptr;
+	(void)old_size;
+	(void)new_size;
+	(void)align;
+	return (NULL);
+}
+
+/* Only the data block itself unmaps, there is nothing else to free. */
+static void vector_file_unmap(void *ctx, void *ptr)
+{
+	const VectorFileHeader *h = (const VectorFileHeader *)ctx;
+
+	assert((!ptr || ptr == (char *)ctx + h->data_offset) && "vector_file_unmap: foreign block");
+	if (ptr == (char *)ctx + h->data_offset)
+		munmap(ctx, (size_t)(h->data_offset + h->count * h->elem_size));
+}
+
+static Allocator vector_file_allocator(void *mapping)
+{
+	Allocator a;
+
+	a.alloc = vector_file_alloc;
+	a.realloc = vector_file_realloc;
+	a.free = vector_file_unmap;
+	a.ctx = mapping;
+	a.usable_size = NULL;
+	a.expand_in_place = NULL;
+	a.alloc_zeroed = NULL;
+	return (a);
+}
+
+static bool vector_file_header_valid(const VectorFileHeader *h, size_t file_size)
+{
+	if (memcmp(h->magic, VECTOR_FILE_MAGIC, sizeof(h->magic)) != 0)
+		return (false);
+	if (h->version != VECTOR_FILE_VERSION || h->elem_size == 0)
+		return (false);
+	if (!vector_file_align_valid(h->align))
+		return (false);
+	if (h->data_offset < sizeof(*h) || h->data_offset > file_size
+		|| (h->align && h->data_offset % h->align != 0))
+		return (false);
+	// Exact, so the header alone tells vector_file_unmap the mapping length
+	if (h->count > (file_size - h->data_offset) / h->elem_size
+		|| h->data_offset + h->count * h->elem_size != file_size)
+		return (false);
+	return (true);
+}
+
+/*
+ * Maps a file written by vector_write/vector_save into out. Nothing is read
+ * up front, elements are paged in on first access. The mapping is private
+ * and writable, so modifying elements copies just those pages and leaves
+ * the file alone. VECTOR_FIXED makes growing fail cleanly, as for a static
+ * vector. vector_destroy unmaps.
+*/
+static bool vector_map(const char *path, Vector *out)
+{
+	assert(path != NULL && out != NULL && "vector_map: NULL argument");
+
+	struct stat	st;
+	int			fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return (false);
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(VectorFileHeader))
+	{
+		close(fd);
+		return (false);
+	}
+
+	size_t	length = (size_t)st.st_size;
+	void	*p = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return (false);
+
+	const VectorFileHeader *h = (const VectorFileHeader *)p;
+	if (!vector_file_header_valid(h, length))
+	{
+		munmap(p, length);
+		return (false);
+	}
+
+	*out = vector_init_aligned(vector_file_allocator(p), (size_t)h->elem_size, (size_t)h->align);
+	out->data = (char *)p + h->data_offset;
+	out->size = (size_t)h->count;
+	out->capacity = (size_t)h->count;
+	out->flags |= VECTOR_FIXED;
+	return (true);
+}
+
+#endif // VECTOR_FILE_H
@@ -0,0 +1,380 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_HASH.H v1.0.0
+   -----------------------------------------------------------------------------
+   Flat open-addressing hash map on Vector storage. Keys and values live in
+   two dense Vectors in insertion order (removal swaps the last entry in), and
+   a Robin Hood probed index table maps hashes to entries, so lookups are
+   O(1) and iterating the map is a linear scan of contiguous arrays.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/vector
+   License: MIT
+   -----------------------------------------------------------------------------
+
+   USAGE:
+	 HashMap m = hmap_init(malloc_allocator(), sizeof(uint32_t), sizeof(User));
+	 hmap_insert(&m, &id, &user);			// inserts or overwrites
+	 User *u = hmap_get_t(&m, User, &id);	// NULL if missing
+	 hmap_remove(&m, &id);
+
+	 for (size_t i = 0; i < hmap_size(&m); ++i)
+		 visit(hmap_key_at(&m, i), hmap_value_at(&m, i));
+
+	 hmap_destroy(&m);
+
+	 Keys hash and compare by their bytes unless hmap_init_custom is given
+	 other functions, e.g. for string keys. Pass value_size 0 for a set.
+	 Pointers from hmap_get are valid until the next insert or remove.
+*/
+
+#ifndef VECTOR_HASH_H
+# define VECTOR_HASH_H
+
+#include "vector.h"
+
+#define HMAP_MIN_SLOTS		16
+#define HMAP_LOAD_NUM		4	// the table grows past 4/5 full
+#define HMAP_LOAD_DEN		5
+
+typedef uint64_t (*hmap_hash_fn)(const void *key, size_t size, void *ctx);
+typedef bool (*hmap_eq_fn)(const void *a, const void *b, size_t size, void *ctx);
+
+/* One index table slot. entry is the dense index + 1, 0 marks an empty slot. */
+typedef struct {
+	uint32_t	hash;
+	uint32_t	entry;
+} HmapSlot;
+
+typedef struct {
+	Vector			keys;
+	Vector			values;		// unused when value_size is 0
+	Vector			slots;		// HmapSlot, power-of-two count
+	size_t			key_size;
+	size_t			value_size;
+	hmap_hash_fn	hash;
+	hmap_eq_fn		eq;
+	void			*ctx;
+} HashMap;
+
+/* User *u = hmap_get_t(&m, User, &id); */
+#define hmap_get_t(m, T, key) ((T *)hmap_get((m), (key)))
+
+/* ==================== */
+/* -- Hashing        -- */
+/* ==================== */
+
+static inline uint64_t hmap_mix(uint64_t x)
+{
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return (x);
+}
+
+/* Default hash, mixes the key eight bytes at a time. */
+static uint64_t hmap_hash_bytes(const void *key, size_t size, void *ctx)
+{
+	const unsigned char	*p = (const unsigned char *)key;
+	uint64_t			h = 0x9e3779b97f4a7c15ULL ^ size;
+	uint64_t			w;
+
+	(void)ctx;
+	while (size >= 8)
+	{
+		memcpy(&w, p, 8);
+		h = hmap_mix(h ^ w);
+		p += 8;
+		size -= 8;
+	}
+	if (size > 0)
+	{
+		w = 0;
+		memcpy(&w, p, size);
+		h = hmap_mix(h ^ w);
+	}
+	return (h);
+}
+
+static bool hmap_eq_bytes(const void *a, const void *b, size_t size, void *ctx)
+{
+	(void)ctx;
+	return (memcmp(a, b, size) == 0);
+}
+
+/* ==================== */
+/* -- Initialization -- */
+/* ==================== */
+
+static HashMap hmap_init_custom(Allocator alloc, size_t key_size, size_t value_size,
+	hmap_hash_fn hash, hmap_eq_fn eq, void *ctx)
+{
+	assert(key_size > 0 && "key_size must be > 0");
+	assert(hash != NULL && eq != NULL && "hash and eq must be set");
+
+	HashMap m;
+	memset(&m, 0, sizeof(m));
+	m.keys = vector_init(alloc, key_size);
+	if (value_size > 0)
+		m.values = vector_init(alloc, value_size);
+	m.slots = vector_init(alloc, sizeof(HmapSlot));
+	m.key_size = key_size;
+	m.value_size = value_size;
+	m.hash = hash;
+	m.eq = eq;
+	m.ctx = ctx;
+	return (m);
+}
+
+static HashMap hmap_init(Allocator alloc, size_t key_size, size_t value_size)
+{
+	return (hmap_init_custom(alloc, key_size, value_size, hmap_hash_bytes, hmap_eq_bytes, NULL));
+}
+
+/* ==================== */
+/* -- Access         -- */
+/* ==================== */
+
+static inline size_t hmap_size(const HashMap *m)
+{
+	return (m->keys.size);
+}
+
+/* Keys and values of entry i, 0 <= i < hmap_size, in insertion order until a remove. */
+static inline void *hmap_key_at(const HashMap *m, size_t i)
+{
+	assert(i < m->keys.size && "index out of bounds");
+	return ((char *)m->keys.data + i * m->key_size);
+}
+
+static inline void *hmap_value_at(const HashMap *m, size_t i)
+{
+	assert(i < m->keys.size && "index out of bounds");
+	if (m->value_size == 0)
+		return (NULL);
+	return ((char *)m->values.data + i * m->value_size);
+}
+
+static inline size_t hmap_distance(const HashMap *m, size_t pos, uint32_t hash)
+{
+	size_t mask = m->slots.size - 1;
+
+	return ((pos - (hash & mask)) & mask);
+}
+
+/*
+ * Slot holding key, or SIZE_MAX. Robin Hood ordering lets the probe stop as
+ * soon as it reaches an entry closer to its home than the key would be.
+*/
+static size_t hmap_find_slot(const HashMap *m, const void *key, uint32_t hash)
+{
+	if (m->slots.size == 0)
+		return (SIZE_MAX);
+
+	const HmapSlot	*slots = vector_data_as(&m->slots, HmapSlot);
+	size_t			mask = m->slots.size - 1;
+	size_t			pos = hash & mask;
+
+	for (size_t dist = 0; ; ++dist)
+	{
+		const HmapSlot *s = &slots[pos];
+		if (s->entry == 0 || hmap_distance(m, pos, s->hash) < dist)
+			return (SIZE_MAX);
+		if (s->hash == hash && m->eq(key, hmap_key_at(m, s->entry - 1), m->key_size, m->ctx))
+			return (pos);
+		pos = (pos + 1) & mask;
+	}
+}
+
+/* Value stored under key, NULL if it isn't in the map (or the map is a set). */
+static void *hmap_get(const HashMap *m, const void *key)
+{
+	assert(m != NULL && key != NULL && "hmap_get: NULL argument");
+
+	size_t pos = hmap_find_slot(m, key, (uint32_t)m->hash(key, m->key_size, m->ctx));
+
+	if (pos == SIZE_MAX)
+		return (NULL);
+	return (hmap_value_at(m, vector_data_as(&m->slots, HmapSlot)[pos].entry - 1));
+}
+
+static bool hmap_contains(const HashMap *m, const void *key)
+{
+	assert(m != NULL && key != NULL && "hmap_contains: NULL argument");
+	return (hmap_find_slot(m, key, (uint32_t)m->hash(key, m->key_size, m->ctx)) != SIZE_MAX);
+}
+
+/* ==================== */
+/* -- Modifiers      -- */
+/* ==================== */
+
+/* Robin Hood insert of a slot known to be absent: richer entries give way. */
+static void hmap_place(HashMap *m, HmapSlot slot)
+{
+	HmapSlot	*slots = vector_data_as(&m->slots, HmapSlot);
+	size_t		mask = m->slots.size - 1;
+	size_t		pos = slot.hash & mask;
+
+	for (size_t dist = 0; ; ++dist)
+	{
+		if (slots[pos].entry == 0)
+		{
+			slots[pos] = slot;
+			return;
+		}
+
+		size_t other = hmap_distance(m, pos, slots[pos].hash);
+		if (other < dist)
+		{
+			HmapSlot tmp = slots[pos];
+			slots[pos] = slot;
+			slot = tmp;
+			dist = other;
+		}
+		pos = (pos + 1) & mask;
+	}
+}
+
+/* Rebuilds the index table with count slots, reusing the hashes stored in it. */
+static bool hmap_rehash(HashMap *m, size_t count)
+{
+	Vector old = m->slots;
+
+	// Zeroed slots are empty, vector_resize gets them from calloc when it can
+	m->slots = vector_init(old.alloc, sizeof(HmapSlot));
+	if (!vector_resize(&m->slots, count))
+	{
+		vector_destroy(&m->slots);
+		m->slots = old;
+		return (false);
+	}
+
+	const HmapSlot *slots = vector_data_as(&old, HmapSlot);
+	for (size_t i = 0; i < old.size; ++i)
+	{
+		if (slots[i].entry != 0)
+			hmap_place(m, slots[i]);
+	}
+	vector_destroy(&old);
+	return (true);
+}
+
+/* Makes room for count entries without growing the table again. */
+static bool hmap_reserve(HashMap *m, size_t count)
+{
+	assert(m != NULL && "hmap_reserve: NULL argument");
+
+	size_t slots = HMAP_MIN_SLOTS;
+
+	if (count > UINT32_MAX - 1)
+		return (false);
+	while (slots / HMAP_LOAD_DEN * HMAP_LOAD_NUM < count)
+		slots *= 2;
+	if (slots > m->slots.size && !hmap_rehash(m, slots))
+		return (false);
+	if (!vector_reserve(&m->keys, count))
+		return (false);
+	return (m->value_size == 0 || vector_reserve(&m->values, count));
+}
+
+/* Inserts key, or overwrites its value if it's already there. value may be NULL for a set. */
+static bool hmap_insert(HashMap *m, const void *key, const void *value)
+{
+	assert(m != NULL && key != NULL && "hmap_insert: NULL argument");
+	assert((value != NULL || m->value_size == 0) && "value is NULL");
+
+	uint32_t	hash = (uint32_t)m->hash(key, m->key_size, m->ctx);
+	size_t		pos = hmap_find_slot(m, key, hash);
+
+	if (pos != SIZE_MAX)
+	{
+		if (m->value_size > 0)
+			memcpy(hmap_value_at(m, vector_data_as(&m->slots, HmapSlot)[pos].entry - 1), value, m->value_size);
+		return (true);
+	}
+
+	size_t count = m->keys.size;
+	if (count + 1 > m->slots.size / HMAP_LOAD_DEN * HMAP_LOAD_NUM && !hmap_reserve(m, count + 1))
+		return (false);
+	if (!vector_push(&m->keys, (void *)key))
+		return (false);
+	if (m->value_size > 0 && !vector_push(&m->values, (void *)value))
+	{
+		vector_pop(&m->keys);
+		return (false);
+	}
+
+	HmapSlot slot;
+	slot.hash = hash;
+	slot.entry = (uint32_t)count + 1;
+	hmap_place(m, slot);
+	return (true);
+}
+
+/*
+ * Removes key. The slot is closed with a backward shift (no tombstones) and
+ * the last entry moves into the freed dense position.
+*/
+static bool hmap_remove(HashMap *m, const void *key)
+{
+	assert(m != NULL && key != NULL && "hmap_remove: NULL argument");
+
+	uint32_t	hash = (uint32_t)m->hash(key, m->key_size, m->ctx);
+	size_t		pos = hmap_find_slot(m, key, hash);
+
+	if (pos == SIZE_MAX)
+		return (false);
+
+	HmapSlot	*slots = vector_data_as(&m->slots, HmapSlot);
+	size_t		mask = m->slots.size - 1;
+	size_t		entry = slots[pos].entry - 1;
+	size_t		next = (pos + 1) & mask;
+
+	while (slots[next].entry != 0 && hmap_distance(m, next, slots[next].hash) > 0)
+	{
+		slots[pos] = slots[next];
+		pos = next;
+		next = (next + 1) & mask;
+	}
+	slots[pos].entry = 0;
+
+	size_t last = m->keys.size - 1;
+	if (entry != last)
+	{
+		// Repoint the last entry's slot at its new dense position
+		const void	*moved = hmap_key_at(m, last);
+		size_t		at = hmap_find_slot(m, moved, (uint32_t)m->hash(moved, m->key_size, m->ctx));
+
+		slots[at].entry = (uint32_t)entry + 1;
+	}
+	vector_swap_pop(&m->keys, entry);
+	if (m->value_size > 0)
+		vector_swap_pop(&m->values, entry);
+	return (true);
+}
+
+static void hmap_clear(HashMap *m)
+{
+	if (!m)
+		return;
+	vector_clear(&m->keys);
+	if (m->value_size > 0)
+		vector_clear(&m->values);
+	if (m->slots.size > 0)
+		memset(m->slots.data, 0, m->slots.size * sizeof(HmapSlot));
+}
+
+static void hmap_destroy(HashMap *m)
+{
+	if (!m)
+		return;
+	vector_destroy(&m->keys);
+	if (m->value_size > 0)
+		vector_destroy(&m->values);
+	vector_destroy(&m->slots);
+	memset(m, 0, sizeof(*m));
+}
+
+#endif // VECTOR_HASH_H
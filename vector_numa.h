@@ -0,0 +1,325 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_NUMA.H v1.0.0
+   -----------------------------------------------------------------------------
+   NUMA placement for vector.h. numa_node_allocator binds every block it
+   maps to one node, numa_local_allocator prefers the node of the thread
+   that allocates, and vector_migrate moves an existing vector's buffer to
+   another node. Talks to the kernel through the mbind syscall directly, so
+   there is nothing to link.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/vector
+   License: MIT
+   -----------------------------------------------------------------------------
+
+   USAGE:
+	 // In a worker pinned to some CPU: its vector stays on its own node
+	 Vector local = vector_init(numa_local_allocator(), sizeof(Item));
+
+	 // Or pick the node explicitly
+	 Vector v = vector_init(numa_node_allocator(1), sizeof(Item));
+	 ...
+	 vector_migrate(&v, 0);		// pages move over, pointers stay valid
+
+	 Blocks are whole pages from mmap, so these suit big per-thread buffers
+	 rather than many tiny vectors. The allocators are stateless, the node
+	 lives in ctx, so there is nothing to keep alive. Define _GNU_SOURCE
+	 before the first #include to let growth mremap instead of copying.
+	 Otherwise the header turns on _DEFAULT_SOURCE for MAP_ANONYMOUS and
+	 syscall, which -std=c11 hides, so include it before any system header
+	 or define that yourself.
+*/
+
+#ifndef VECTOR_NUMA_H
+# define VECTOR_NUMA_H
+
+#ifndef _DEFAULT_SOURCE
+# define _DEFAULT_SOURCE
+#endif
+
+#include "vector.h"
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define NUMA_NODE_LOCAL		(-1)	// the node of the calling thread
+
+#ifndef NUMA_MAX_NODES
+# define NUMA_MAX_NODES		1024
+#endif
+
+// Kernel mempolicy values, under our own names so <numaif.h> can coexist
+#define NUMA_MPOL_PREFERRED	1
+#define NUMA_MPOL_BIND		2
+#define NUMA_MPOL_MF_MOVE	(1 << 1)
+
+/*
+ * ctx of a NUMA allocator: the node + 1 above a 16-bit tag. The tag is odd,
+ * so no object pointer looks like one, and it works across translation
+ * units, where each has its own copy of the static callbacks.
+*/
+#define NUMA_CTX_TAG		0x4e55
+#define NUMA_CTX(node)		((void *)(((intptr_t)(node) + 1) << 16 | NUMA_CTX_TAG))
+#define NUMA_CTX_NODE(ctx)	((int)(((intptr_t)(ctx) >> 16) - 1))
+#define NUMA_BLOCK_MAGIC	0x4e554d41424c4bULL	// "NUMABLK"
+
+/* Stored right before every block, locates the mapping it lives in. */
+typedef struct {
+	void		*base;
+	size_t		length;
+	uint64_t	magic;	// NUMA_BLOCK_MAGIC
+} NumaBlock;
+
+/* ==================== */
+/* -- Placement      -- */
+/* ==================== */
+
+/* Node of the CPU the calling thread runs on right now, 0 if unknown. */
+static int numa_current_node(void)
+{
+	unsigned int cpu;
+	unsigned int node;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+		return (0);
+	return ((int)node);
+}
+
+/*
+ * Applies mode for node to [base, base + length). A kernel without NUMA
+ * support has one node, so ENOSYS counts as success.
+*/
+static bool numa_block_bind(void *base, size_t length, int mode, int node, unsigned int flags)
+{
+	unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long))];
+
+	if (node < 0 || node >= NUMA_MAX_NODES)
+		return (false);
+	memset(mask, 0, sizeof(mask));
+	mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+	// The kernel reads maxnode - 1 bits
+	if (syscall(SYS_mbind, base, length, mode, mask, (unsigned long)NUMA_MAX_NODES + 1, flags) == 0)
+		return (true);
+	return (errno == ENOSYS);
+}
+
+/* ==================== */
+/* -- Allocator      -- */
+/* ==================== */
+
+static NumaBlock *numa_block(void *ptr)
+{
+	return ((NumaBlock *)((char *)ptr - sizeof(NumaBlock)));
+}
+
+static void numa_block_set(void *ptr, void *base, size_t length)
+{
+	numa_block(ptr)->base = base;
+	numa_block(ptr)->length = length;
+	numa_block(ptr)->magic = NUMA_BLOCK_MAGIC;
+}
+
+/*
+ * ctx holds the node, or NUMA_NODE_LOCAL. The mapping is bound before any page
+ * is touched, so every page faults in on the right node. Local blocks only
+ * prefer the node, so they fall back to another one when it's full.
+*/
+static void *numa_block_alloc(void *ctx, size_t size, size_t align)
+{
+	int		node = NUMA_CTX_NODE(ctx);
+	int		mode = node == NUMA_NODE_LOCAL ? NUMA_MPOL_PREFERRED : NUMA_MPOL_BIND;
+	size_t	page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t	a = align > 16 ? align : 16;	// malloc's alignment at least
+
+	if (size > SIZE_MAX - sizeof(NumaBlock) - a - page)
+		return (NULL);
+
+	size_t	length = (size + sizeof(NumaBlock) + a + page - 1) & ~(page - 1);
+	void	*base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		return (NULL);
+	if (node == NUMA_NODE_LOCAL)
+		node = numa_current_node();
+	// EPERM: a sandbox forbids placement, the memory itself is still fine
+	if (!numa_block_bind(base, length, mode, node, 0) && errno != EPERM)
+	{
+		munmap(base, length);
+		return (NULL);
+	}
+
+	uintptr_t p = ((uintptr_t)base + sizeof(NumaBlock) + a - 1) & ~(uintptr_t)(a - 1);
+	numa_block_set((void *)p, base, length);
+	return ((void *)p);
+}
+
+static void numa_block_free(void *ctx, void *ptr)
+{
+	(void)ctx;
+	if (ptr)
+		munmap(numa_block(ptr)->base, numa_block(ptr)->length);
+}
+
+/* Everything up to the end of the last page belongs to the block. */
+static size_t numa_block_usable(void *ctx, void *ptr, size_t size)
+{
+	NumaBlock *b = numa_block(ptr);
+
+	(void)ctx;
+	(void)size;
+	return (b->length - (size_t)((char *)ptr - (char *)b->base));
+}
+
+#ifdef MREMAP_MAYMOVE
+/*
+ * The memory policy belongs to the mapping, so pages added by mremap land on
+ * the same node and nothing is copied, even when the mapping moves.
+*/
+static void *numa_block_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+	if (!ptr)
+		return (numa_block_alloc(ctx, new_size, align));
+	// A moved mapping is only page aligned, stricter blocks are copied
+	if (align > page)
+	{
+		void *p = numa_block_alloc(ctx, new_size, align);
+		if (p)
+		{
+			memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+			numa_block_free(ctx, ptr);
+		}
+		return (p);
+	}
+
+	NumaBlock	*b = numa_block(ptr);
+	size_t		offset = (size_t)((char *)ptr - (char *)b->base);
+	if (new_size > SIZE_MAX - offset - page)
+		return (NULL);
+
+	size_t	length = (offset + new_size + page - 1) & ~(page - 1);
+	void	*base = mremap(b->base, b->length, length, MREMAP_MAYMOVE);
+	if (base == MAP_FAILED)
+		return (NULL);
+	numa_block_set((char *)base + offset, base, length);
+	return ((char *)base + offset);
+}
+
+/* Grows the mapping where it is if the address space after it is free. */
+static bool numa_block_expand(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+	NumaBlock	*b = numa_block(ptr);
+	size_t		page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t		offset = (size_t)((char *)ptr - (char *)b->base);
+
+	(void)ctx;
+	(void)old_size;
+	if (new_size > SIZE_MAX - offset - page)
+		return (false);
+
+	size_t length = (offset + new_size + page - 1) & ~(page - 1);
+	if (length <= b->length)
+		return (true);
+	if (mremap(b->base, b->length, length, 0) == MAP_FAILED)
+		return (false);
+	b->length = length;
+	return (true);
+}
+#endif
+
+/*
+ * True if alloc is a NUMA allocator. Our own callbacks settle it; another
+ * translation unit has its own copies, so there it takes the ctx tag plus
+ * the shape numa_node_allocator gives every NUMA allocator.
+*/
+static bool numa_is_allocator(const Allocator *alloc)
+{
+	if (alloc->alloc == numa_block_alloc)
+		return (true);
+	return (((intptr_t)alloc->ctx & 0xffff) == NUMA_CTX_TAG
+		&& alloc->alloc && alloc->alloc_zeroed == alloc->alloc
+		&& alloc->free && alloc->usable_size);
+}
+
+/* Bound to node; blocks are fresh mappings, so they always read as zero. */
+static Allocator numa_node_allocator(int node)
+{
+	assert(node >= NUMA_NODE_LOCAL && node < NUMA_MAX_NODES && "node out of range");
+
+	Allocator a;
+
+	a.alloc = numa_block_alloc;
+	a.free = numa_block_free;
+	a.ctx = NUMA_CTX(node);
+	a.usable_size = numa_block_usable;
+#ifdef MREMAP_MAYMOVE
+	a.realloc = numa_block_realloc;
+	a.expand_in_place = numa_block_expand;
+#else
+	a.realloc = NULL;
+	a.expand_in_place = NULL;
+#endif
+	a.alloc_zeroed = numa_block_alloc;
+	return (a);
+}
+
+/* Prefers the node of whichever thread makes each allocation. */
+static Allocator numa_local_allocator(void)
+{
+	return (numa_node_allocator(NUMA_NODE_LOCAL));
+}
+
+/* ==================== */
+/* -- Migration      -- */
+/* ==================== */
+
+/*
+ * Moves v's buffer to node (or the caller's, NUMA_NODE_LOCAL) and makes it
+ * allocate from there from now on. A buffer from a NUMA allocator is rebound
+ * and the kernel migrates its pages, so data doesn't move and nothing is
+ * copied. Any other buffer is copied into a block on node and the old one
+ * freed through the old allocator.
+*/
+static bool vector_migrate(Vector *v, int node)
+{
+	assert(v != NULL && "vector_migrate: NULL vector");
+
+	if (!v || (v->flags & VECTOR_FIXED))
+		return (false);
+	if (node == NUMA_NODE_LOCAL)
+		node = numa_current_node();
+	// Migrating a shared buffer would move it under every other clone
+	if (v->refs && !vector_make_unique(v))
+		return (false);
+
+	Allocator to = numa_node_allocator(node);
+	bool owned = v->data && !(v->flags & VECTOR_INLINE);
+
+	// Only NUMA blocks have a header to look at
+	if (owned && numa_is_allocator(&v->alloc) && numa_block(v->data)->magic == NUMA_BLOCK_MAGIC)
+	{
+		NumaBlock *b = numa_block(v->data);
+		// EPERM as in numa_block_alloc: placement is forbidden, the data is fine
+		if (!numa_block_bind(b->base, b->length, NUMA_MPOL_BIND, node, NUMA_MPOL_MF_MOVE)
+			&& errno != EPERM)
+			return (false);
+	}
+	else if (v->data)
+	{
+		void *p = to.alloc(to.ctx, v->capacity * v->elem_size, v->align);
+		if (!p)
+			return (false);
+		memcpy(p, v->data, v->size * v->elem_size);
+		if (owned && v->alloc.free)
+			v->alloc.free(v->alloc.ctx, v->data);
+		v->data = p;
+		v->flags &= ~VECTOR_INLINE;
+		v->capacity = numa_block_usable(to.ctx, p, 0) / v->elem_size;
+	}
+	v->alloc = to;
+	return (true);
+}
+
+#endif // VECTOR_NUMA_H
@@ -0,0 +1,507 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_PARALLEL.H v1.0.0
+   -----------------------------------------------------------------------------
+   Parallel sort, for_each, transform and reduce over a Vector's contiguous
+   data, on a small pthread pool. Work is split into chunks whose boundaries
+   fall on cache lines, and threads pull chunks from a shared atomic counter
+   so faster threads pick up the slack.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/vector
+   License: MIT
+   -----------------------------------------------------------------------------
+
+   USAGE:
+	 ParallelPool pool;
+	 parallel_pool_init(&pool, 0);	// 0 = one thread per online CPU
+
+	 vector_parallel_sort(&pool, &v, cmp, NULL);
+	 vector_parallel_for_each(&pool, &v, scale_chunk, &factor);
+	 vector_parallel_transform(&pool, &out, &v, square_chunk, NULL);
+	 vector_parallel_reduce(&pool, &v, &sum, sizeof(sum), sum_chunk, add_partial, NULL);
+
+	 parallel_pool_destroy(&pool);
+
+	 Callbacks get whole chunks (pointer + count) so their inner loops can be
+	 as tight as hand-written ones. The calling thread takes part in every
+	 job, so a pool of 1 thread runs everything inline.
+*/
+
+#ifndef VECTOR_PARALLEL_H
+# define VECTOR_PARALLEL_H
+
+#include "vector.h"
+#include "vector_algo.h"
+#include <pthread.h>
+#include <unistd.h>
+
+#ifndef PARALLEL_CACHE_LINE
+# define PARALLEL_CACHE_LINE	64
+#endif
+#define PARALLEL_CHUNKS_PER_THREAD	4	// more chunks than threads balances uneven work
+#define PARALLEL_MIN_CHUNK_BYTES	(64 * 1024)
+
+/* Runs chunk number `chunk` of the current job. */
+typedef void (*parallel_task_fn)(size_t chunk, void *ctx);
+
+typedef struct {
+	pthread_t			*threads;
+	size_t				nthreads;	// workers, the caller is one more
+	pthread_mutex_t		lock;
+	pthread_cond_t		wake;
+	pthread_cond_t		done;
+	parallel_task_fn	task;
+	void				*task_ctx;
+	size_t				nchunks;
+	size_t				next;		// next chunk to hand out, atomic
+	size_t				active;		// workers still on the current job
+	size_t				generation;
+	bool				stop;
+} ParallelPool;
+
+/* Callbacks, each gets a contiguous run of count elements. */
+typedef void (*parallel_each_fn)(void *elems, size_t count, size_t first, void *ctx);
+typedef void (*parallel_transform_fn)(void *out, const void *in, size_t count, void *ctx);
+typedef void (*parallel_reduce_fn)(void *acc, const void *elems, size_t count, void *ctx);
+typedef void (*parallel_combine_fn)(void *acc, const void *partial, void *ctx);
+
+/* ==================== */
+/* -- Thread pool    -- */
+/* ==================== */
+
+static void parallel_run_chunks(ParallelPool *pool)
+{
+	size_t chunk;
+
+	while ((chunk = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) < pool->nchunks)
+		pool->task(chunk, pool->task_ctx);
+}
+
+static void *parallel_worker(void *arg)
+{
+	ParallelPool	*pool = (ParallelPool *)arg;
+	size_t			seen = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;)
+	{
+		while (!pool->stop && pool->generation == seen)
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		if (pool->stop)
+			break;
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		parallel_run_chunks(pool);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->active == 0)
+			pthread_cond_signal(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return (NULL);
+}
+
+/*
+ * Starts threads - 1 workers (0 = one per online CPU). Returns false if no
+ * worker could be started, the pool then still runs jobs on the caller.
+*/
+static bool parallel_pool_init(ParallelPool *pool, size_t threads)
+{
+	assert(pool != NULL && "pool is NULL");
+
+	if (threads == 0)
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cpus > 0 ? (size_t)cpus : 1;
+	}
+	memset(pool, 0, sizeof(*pool));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	if (threads == 1)
+		return (true);
+
+	pool->threads = (pthread_t *)malloc((threads - 1) * sizeof(pthread_t));
+	if (!pool->threads)
+		return (false);
+	for (size_t i = 0; i < threads - 1; ++i)
+	{
+		if (pthread_create(&pool->threads[i], NULL, parallel_worker, pool) != 0)
+			break;
+		pool->nthreads++;
+	}
+	return (pool->nthreads > 0);
+}
+
+static void parallel_pool_destroy(ParallelPool *pool)
+{
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = true;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+	for (size_t i = 0; i < pool->nthreads; ++i)
+		pthread_join(pool->threads[i], NULL);
+	free(pool->threads);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->wake);
+	pthread_cond_destroy(&pool->done);
+	memset(pool, 0, sizeof(*pool));
+}
+
+/* Runs task over nchunks chunks on every thread of the pool and waits for it. */
+static void parallel_run(ParallelPool *pool, size_t nchunks, parallel_task_fn task, void *ctx)
+{
+	pool->task = task;
+	pool->task_ctx = ctx;
+	pool->nchunks = nchunks;
+	__atomic_store_n(&pool->next, 0, __ATOMIC_RELAXED);
+
+	pthread_mutex_lock(&pool->lock);
+	pool->active = pool->nthreads;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+
+	parallel_run_chunks(pool);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->active > 0)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static size_t parallel_threads(const ParallelPool *pool)
+{
+	return (pool->nthreads + 1);
+}
+
+/* ==================== */
+/* -- Chunking       -- */
+/* ==================== */
+
+/* Enough chunks to balance the threads, but none smaller than PARALLEL_MIN_CHUNK_BYTES. */
+static size_t parallel_chunk_count(const ParallelPool *pool, size_t n, size_t w)
+{
+	size_t chunks = parallel_threads(pool) * PARALLEL_CHUNKS_PER_THREAD;
+	size_t max_chunks = n * w / PARALLEL_MIN_CHUNK_BYTES;
+
+	if (chunks > max_chunks)
+		chunks = max_chunks;
+	return (chunks > 0 ? chunks : 1);
+}
+
+/*
+ * First element of chunk k out of nchunks. The even split is moved up to the
+ * next cache line boundary of base, so two chunks never write the same line.
+*/
+static size_t parallel_bound(const void *base, size_t n, size_t w, size_t nchunks, size_t k)
+{
+	if (k == 0)
+		return (0);
+	if (k >= nchunks)
+		return (n);
+
+	size_t		idx = (size_t)((unsigned long long)n * k / nchunks);
+	uintptr_t	addr = (uintptr_t)base + idx * w;
+	uintptr_t	line = (addr + PARALLEL_CACHE_LINE - 1) & ~(uintptr_t)(PARALLEL_CACHE_LINE - 1);
+
+	idx = (size_t)((line - (uintptr_t)base + w - 1) / w);
+	return (idx < n ? idx : n);
+}
+
+/* ==================== */
+/* -- for_each       -- */
+/* ==================== */
+
+typedef struct {
+	char				*data;
+	size_t				n;
+	size_t				w;
+	size_t				nchunks;
+	parallel_each_fn	fn;
+	void				*ctx;
+} ParallelEach;
+
+static void parallel_each_task(size_t chunk, void *arg)
+{
+	ParallelEach	*job = (ParallelEach *)arg;
+	size_t			first = parallel_bound(job->data, job->n, job->w, job->nchunks, chunk);
+	size_t			last = parallel_bound(job->data, job->n, job->w, job->nchunks, chunk + 1);
+
+	if (first < last)
+		job->fn(job->data + first * job->w, last - first, first, job->ctx);
+}
+
+/* Calls fn on disjoint chunks covering [0, size), with the index of each chunk's first element. */
+static void vector_parallel_for_each(ParallelPool *pool, Vector *v, parallel_each_fn fn, void *ctx)
+{
+	assert(pool != NULL && v != NULL && fn != NULL && "vector_parallel_for_each: NULL argument");
+
+	ParallelEach job;
+
+	if (v->size == 0 || !vector_make_unique(v))
+		return;
+	job.data = (char *)v->data;
+	job.n = v->size;
+	job.w = v->elem_size;
+	job.nchunks = parallel_chunk_count(pool, v->size, v->elem_size);
+	job.fn = fn;
+	job.ctx = ctx;
+	parallel_run(pool, job.nchunks, parallel_each_task, &job);
+}
+
+/* ==================== */
+/* -- transform      -- */
+/* ==================== */
+
+typedef struct {
+	char					*out;
+	const char				*in;
+	size_t					n;
+	size_t					out_w;
+	size_t					in_w;
+	size_t					nchunks;
+	parallel_transform_fn	fn;
+	void					*ctx;
+} ParallelTransform;
+
+static void parallel_transform_task(size_t chunk, void *arg)
+{
+	ParallelTransform	*job = (ParallelTransform *)arg;
+	// Chunks follow the output's cache lines, that's where the writes go
+	size_t				first = parallel_bound(job->out, job->n, job->out_w, job->nchunks, chunk);
+	size_t				last = parallel_bound(job->out, job->n, job->out_w, job->nchunks, chunk + 1);
+
+	if (first < last)
+		job->fn(job->out + first * job->out_w, job->in + first * job->in_w, last - first, job->ctx);
+}
+
+/*
+ * Fills dst with src->size elements produced by fn from the matching chunks
+ * of src. dst keeps its own elem_size, so the output type can differ.
+ * 		Note: dst must not be src, transform in place with for_each instead.
+*/
+static bool vector_parallel_transform(ParallelPool *pool, Vector *dst, const Vector *src,
+	parallel_transform_fn fn, void *ctx)
+{
+	assert(pool != NULL && dst != NULL && src != NULL && fn != NULL
+		&& "vector_parallel_transform: NULL argument");
+	assert(dst != src && "vector_parallel_transform: dst aliases src");
+
+	ParallelTransform job;
+
+	if (!vector_resize_uninit(dst, src->size))
+		return (false);
+	if (src->size == 0)
+		return (true);
+	job.out = (char *)dst->data;
+	job.in = (const char *)src->data;
+	job.n = src->size;
+	job.out_w = dst->elem_size;
+	job.in_w = src->elem_size;
+	job.nchunks = parallel_chunk_count(pool, src->size, src->elem_size);
+	job.fn = fn;
+	job.ctx = ctx;
+	parallel_run(pool, job.nchunks, parallel_transform_task, &job);
+	return (true);
+}
+
+/* ==================== */
+/* -- reduce         -- */
+/* ==================== */
+
+typedef struct {
+	const char			*data;
+	size_t				n;
+	size_t				w;
+	size_t				nchunks;
+	char				*partials;
+	size_t				stride;
+	parallel_reduce_fn	fn;
+	void				*ctx;
+} ParallelReduce;
+
+static void parallel_reduce_task(size_t chunk, void *arg)
+{
+	ParallelReduce	*job = (ParallelReduce *)arg;
+	size_t			first = parallel_bound(job->data, job->n, job->w, job->nchunks, chunk);
+	size_t			last = parallel_bound(job->data, job->n, job->w, job->nchunks, chunk + 1);
+
+	if (first < last)
+		job->fn(job->partials + chunk * job->stride, job->data + first * job->w, last - first, job->ctx);
+}
+
+/*
+ * Reduces v into *result. result holds the identity value on entry; every
+ * chunk starts from a copy of it, reduces its elements with fn, and the
+ * partials are folded into result with combine in chunk order, so the
+ * outcome doesn't depend on thread timing. The partials come from v's
+ * allocator; without free, or if it has no memory, v is reduced on the
+ * calling thread straight into result instead.
+*/
+static bool vector_parallel_reduce(ParallelPool *pool, const Vector *v, void *result, size_t result_size,
+	parallel_reduce_fn fn, parallel_combine_fn combine, void *ctx)
+{
+	assert(pool != NULL && v != NULL && result != NULL && fn != NULL && combine != NULL
+		&& "vector_parallel_reduce: NULL argument");
+
+	ParallelReduce	job;
+	// Partials padded to whole cache lines so threads don't share them
+	size_t			stride = (result_size + PARALLEL_CACHE_LINE - 1) & ~(size_t)(PARALLEL_CACHE_LINE - 1);
+
+	if (v->size == 0)
+		return (true);
+	job.nchunks = parallel_chunk_count(pool, v->size, v->elem_size);
+	job.partials = NULL;
+	if (v->alloc.free)
+		job.partials = (char *)v->alloc.alloc(v->alloc.ctx, job.nchunks * stride, PARALLEL_CACHE_LINE);
+	if (!job.partials)
+	{
+		fn(result, v->data, v->size, ctx);
+		return (true);
+	}
+	for (size_t i = 0; i < job.nchunks; ++i)
+		memcpy(job.partials + i * stride, result, result_size);
+	job.data = (const char *)v->data;
+	job.n = v->size;
+	job.w = v->elem_size;
+	job.stride = stride;
+	job.fn = fn;
+	job.ctx = ctx;
+	parallel_run(pool, job.nchunks, parallel_reduce_task, &job);
+
+	for (size_t i = 0; i < job.nchunks; ++i)
+		combine(result, job.partials + i * stride, ctx);
+	v->alloc.free(v->alloc.ctx, job.partials);
+	return (true);
+}
+
+/* vector_parallel_reduce_t(&pool, &v, &sum, double, sum_chunk, add_partial, NULL); */
+#define vector_parallel_reduce_t(pool, v, result, T, fn, combine, ctx) \
+	vector_parallel_reduce((pool), (v), (result), sizeof(T), (fn), (combine), (ctx))
+
+/* ==================== */
+/* -- sort           -- */
+/* ==================== */
+
+typedef struct {
+	char			*src;
+	char			*dst;
+	size_t			w;
+	size_t			*runs;		// run k is [runs[k], runs[k + 1])
+	size_t			nruns;
+	vector_cmp_fn	cmp;
+	void			*ctx;
+} ParallelSort;
+
+static void parallel_sort_task(size_t chunk, void *arg)
+{
+	ParallelSort	*job = (ParallelSort *)arg;
+	size_t			first = job->runs[chunk];
+	size_t			n = job->runs[chunk + 1] - first;
+
+	if (n > 1)
+		algo_intro_sort(job->src + first * job->w, n, job->w, job->cmp, job->ctx, algo_depth_limit(n));
+}
+
+/* Merges run pair `chunk` (runs 2k and 2k + 1) from src into dst. */
+static void parallel_merge_task(size_t chunk, void *arg)
+{
+	ParallelSort	*job = (ParallelSort *)arg;
+	size_t			w = job->w;
+	size_t			lo = job->runs[2 * chunk];
+	size_t			mid = 2 * chunk + 1 < job->nruns ? job->runs[2 * chunk + 1] : job->runs[job->nruns];
+	size_t			hi = 2 * chunk + 2 <= job->nruns ? job->runs[2 * chunk + 2] : job->runs[job->nruns];
+	size_t			i = lo;
+	size_t			j = mid;
+	char			*out = job->dst + lo * w;
+
+	while (i < mid && j < hi)
+	{
+		// <= keeps equal elements of the left run first
+		if (job->cmp(job->src + i * w, job->src + j * w, job->ctx) <= 0)
+			memcpy(out, job->src + (i++) * w, w);
+		else
+			memcpy(out, job->src + (j++) * w, w);
+		out += w;
+	}
+	memcpy(out, job->src + i * w, (mid - i) * w);
+	out += (mid - i) * w;
+	memcpy(out, job->src + j * w, (hi - j) * w);
+}
+
+/*
+ * Sorts each thread's share with introsort in parallel, then merges the
+ * sorted runs pairwise, each round's merges running in parallel. Needs one
+ * scratch buffer of size * elem_size bytes from v's allocator; without free,
+ * or if it has no memory, v is sorted on the calling thread. Not stable.
+*/
+static bool vector_parallel_sort(ParallelPool *pool, Vector *v, vector_cmp_fn cmp, void *ctx)
+{
+	assert(pool != NULL && v != NULL && cmp != NULL && "vector_parallel_sort: NULL argument");
+
+	ParallelSort	job;
+	size_t			nruns = parallel_chunk_count(pool, v->size, v->elem_size);
+
+	if (nruns > parallel_threads(pool))
+		nruns = parallel_threads(pool);
+	if (!vector_make_unique(v))
+		return (false);
+
+	size_t	*runs = NULL;
+	char	*tmp = NULL;
+	// Without free the scratch would stay allocated, e.g. in an arena
+	if (nruns > 1 && v->alloc.free)
+	{
+		runs = (size_t *)v->alloc.alloc(v->alloc.ctx, (nruns + 1) * sizeof(size_t), 0);
+		if (runs)
+			tmp = (char *)v->alloc.alloc(v->alloc.ctx, v->size * v->elem_size, v->align);
+	}
+	if (!tmp)
+	{
+		if (runs)
+			v->alloc.free(v->alloc.ctx, runs);
+		vector_sort_by(v, cmp, ctx);
+		return (true);
+	}
+	for (size_t k = 0; k <= nruns; ++k)
+		runs[k] = parallel_bound(v->data, v->size, v->elem_size, nruns, k);
+
+	job.src = (char *)v->data;
+	job.dst = tmp;
+	job.w = v->elem_size;
+	job.runs = runs;
+	job.nruns = nruns;
+	job.cmp = cmp;
+	job.ctx = ctx;
+	parallel_run(pool, nruns, parallel_sort_task, &job);
+
+	while (job.nruns > 1)
+	{
+		size_t pairs = (job.nruns + 1) / 2;
+
+		parallel_run(pool, pairs, parallel_merge_task, &job);
+		// Every other boundary disappears with the merged runs
+		for (size_t k = 0; k < pairs; ++k)
+			job.runs[k] = job.runs[2 * k];
+		job.runs[pairs] = v->size;
+		job.nruns = pairs;
+
+		char *swap = job.src;
+		job.src = job.dst;
+		job.dst = swap;
+	}
+	if (job.src != v->data)
+		memcpy(v->data, job.src, v->size * v->elem_size);
+	// Newest first, so an arena can rewind both
+	v->alloc.free(v->alloc.ctx, tmp);
+	v->alloc.free(v->alloc.ctx, runs);
+	return (true);
+}
+
+#endif // VECTOR_PARALLEL_H
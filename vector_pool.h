@@ -0,0 +1,281 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_POOL.H v1.0.0
+   -----------------------------------------------------------------------------
+   Size-class free-list allocator for vector.h. Blocks are binned into
+   power-of-two classes matching the capacities grow_vector produces, and
+   freed blocks go onto a per-class free list to be handed straight to the
+   next vector of the same class.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/vector
+   License: MIT
+   -----------------------------------------------------------------------------
+
+   USAGE:
+	 // Thread-local pool, nothing to set up
+	 Vector v = vector_init(pool_thread_allocator(), sizeof(int));
+
+	 // Or an explicit pool (not thread-safe, keep it to one thread)
+	 VectorPool pool = {0};
+	 Vector w = vector_init(pool_allocator(&pool), sizeof(int));
+	 ...
+	 pool_trim(&pool); // releases the cached blocks back to malloc
+
+	 Blocks larger than 1 << POOL_MAX_SHIFT bytes bypass the free lists, and
+	 a pool caches at most POOL_MAX_CACHED_BYTES in total. A thread's own
+	 pool is trimmed when the thread exits, through a pthread key; define
+	 POOL_NO_PTHREAD to drop that and call pool_thread_release() yourself
+	 before each thread returns.
+*/
+
+#ifndef VECTOR_POOL_H
+# define VECTOR_POOL_H
+
+#include "vector.h"
+#ifndef POOL_NO_PTHREAD
+# include <pthread.h>
+#endif
+
+#define POOL_MIN_SHIFT	4	// smallest class, 16 bytes
+#ifndef POOL_MAX_SHIFT
+# define POOL_MAX_SHIFT	20	// largest class, 1 MiB
+#endif
+#define POOL_CLASSES	(POOL_MAX_SHIFT - POOL_MIN_SHIFT + 1)
+#ifndef POOL_MAX_CACHED
+# define POOL_MAX_CACHED	64	// free blocks kept per class
+#endif
+#ifndef POOL_MAX_CACHED_BYTES
+# define POOL_MAX_CACHED_BYTES	((size_t)8 << 20)	// free bytes kept per pool, all classes
+#endif
+
+/*
+ * Every block is preceded by a 16-byte header holding its size class and
+ * the offset back to the start of the underlying malloc block.
+*/
+#define POOL_HEADER		16
+#define POOL_LARGE		((size_t)-1)
+
+#if defined(__cplusplus)
+# define POOL_THREAD_LOCAL thread_local
+#else
+# define POOL_THREAD_LOCAL _Thread_local
+#endif
+
+typedef struct PoolBlock {
+	struct PoolBlock	*next;
+} PoolBlock;
+
+typedef struct {
+	PoolBlock	*free_list[POOL_CLASSES];
+	size_t		cached[POOL_CLASSES];
+	size_t		cached_bytes;
+} VectorPool;
+
+static size_t *pool_header(void *ptr)
+{
+	return ((size_t *)ptr - 2);
+}
+
+/* Frees every cached block of pool back to malloc. */
+static void pool_drain(VectorPool *pool)
+{
+	for (size_t k = 0; k < POOL_CLASSES; ++k)
+	{
+		while (pool->free_list[k])
+		{
+			PoolBlock *b = pool->free_list[k];
+			pool->free_list[k] = b->next;
+			free((char *)b - pool_header(b)[1]);
+		}
+		pool->cached[k] = 0;
+	}
+	pool->cached_bytes = 0;
+}
+
+/* ==================== */
+/* -- Thread pools   -- */
+/* ==================== */
+
+static POOL_THREAD_LOCAL VectorPool	pool_tls;
+
+#ifndef POOL_NO_PTHREAD
+static POOL_THREAD_LOCAL bool	pool_tls_registered;
+static pthread_key_t			pool_key;
+static pthread_once_t	pool_key_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Runs at thread exit. A later destructor that frees into the pool again
+ * registers it again, and pthreads calls this once more.
+*/
+static void pool_thread_exit(void *pool)
+{
+	pool_drain((VectorPool *)pool);
+	pool_tls_registered = false;
+}
+
+static void pool_key_create(void)
+{
+	pthread_key_create(&pool_key, pool_thread_exit);
+}
+#endif
+
+static VectorPool *pool_thread(void)
+{
+#ifndef POOL_NO_PTHREAD
+	if (!pool_tls_registered)
+	{
+		pthread_once(&pool_key_once, pool_key_create);
+		pthread_setspecific(pool_key, &pool_tls);
+		pool_tls_registered = true;
+	}
+#endif
+	return (&pool_tls);
+}
+
+static size_t pool_class(size_t size)
+{
+	size_t k = 0;
+
+	while (k < POOL_CLASSES && ((size_t)1 << (k + POOL_MIN_SHIFT)) < size)
+		k++;
+	return (k < POOL_CLASSES ? k : POOL_LARGE);
+}
+
+/* ==================== */
+/* -- Allocator      -- */
+/* ==================== */
+
+static void *pool_new_block(size_t size_class, size_t size, size_t align)
+{
+	size_t	header = align > POOL_HEADER ? align : POOL_HEADER;
+	char	*raw;
+
+	if (size_class != POOL_LARGE)
+		size = (size_t)1 << (size_class + POOL_MIN_SHIFT);
+	if (size > SIZE_MAX - header)
+		return (NULL);
+	raw = (char *)malloc_alloc(NULL, header + size, align > POOL_HEADER ? align : 0);
+	if (!raw)
+		return (NULL);
+
+	char *ptr = raw + header;
+	pool_header(ptr)[0] = size_class;
+	pool_header(ptr)[1] = header;
+	return (ptr);
+}
+
+static void *pool_alloc(void *ctx, size_t size, size_t align)
+{
+	VectorPool	*pool = ctx ? (VectorPool *)ctx : pool_thread();
+	size_t		k = pool_class(size);
+
+	// Over-aligned blocks are never pooled so every cached block fits any request
+	if (align > POOL_HEADER || k == POOL_LARGE)
+		return (pool_new_block(POOL_LARGE, size, align));
+	if (pool->free_list[k])
+	{
+		PoolBlock *b = pool->free_list[k];
+		pool->free_list[k] = b->next;
+		pool->cached[k]--;
+		pool->cached_bytes -= (size_t)1 << (k + POOL_MIN_SHIFT);
+		return (b);
+	}
+	return (pool_new_block(k, size, 0));
+}
+
+static void pool_free(void *ctx, void *ptr)
+{
+	VectorPool	*pool = ctx ? (VectorPool *)ctx : pool_thread();
+
+	if (!ptr)
+		return;
+
+	size_t k = pool_header(ptr)[0];
+	if (k == POOL_LARGE || pool->cached[k] >= POOL_MAX_CACHED
+		|| pool->cached_bytes + ((size_t)1 << (k + POOL_MIN_SHIFT)) > POOL_MAX_CACHED_BYTES)
+	{
+		free((char *)ptr - pool_header(ptr)[1]);
+		return;
+	}
+
+	PoolBlock *b = (PoolBlock *)ptr;
+	b->next = pool->free_list[k];
+	pool->free_list[k] = b;
+	pool->cached[k]++;
+	pool->cached_bytes += (size_t)1 << (k + POOL_MIN_SHIFT);
+}
+
+static void *pool_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align)
+{
+	if (!ptr)
+		return (pool_alloc(ctx, new_size, align));
+
+	size_t k = pool_header(ptr)[0];
+
+	// Still fits the class it was cut from
+	if (k != POOL_LARGE && new_size <= ((size_t)1 << (k + POOL_MIN_SHIFT)))
+		return (ptr);
+	// Large unaligned blocks stay large, let realloc try to grow them in place
+	if (k == POOL_LARGE && pool_header(ptr)[1] == POOL_HEADER && align <= POOL_HEADER
+		&& pool_class(new_size) == POOL_LARGE && new_size <= SIZE_MAX - POOL_HEADER)
+	{
+		char *raw = (char *)realloc((char *)ptr - POOL_HEADER, POOL_HEADER + new_size);
+		return (raw ? raw + POOL_HEADER : NULL);
+	}
+
+	void *new_block = pool_alloc(ctx, new_size, align);
+	if (!new_block)
+		return (NULL);
+	memcpy(new_block, ptr, old_size < new_size ? old_size : new_size);
+	pool_free(ctx, ptr);
+	return (new_block);
+}
+
+static size_t pool_usable(void *ctx, void *ptr, size_t size)
+{
+	(void)ctx;
+
+	size_t k = pool_header(ptr)[0];
+	if (k == POOL_LARGE)
+		return (size);
+	return ((size_t)1 << (k + POOL_MIN_SHIFT));
+}
+
+/* Releases every cached block of the pool (NULL = this thread's pool) to malloc. */
+static void pool_trim(VectorPool *pool)
+{
+	pool_drain(pool ? pool : &pool_tls);
+}
+
+/*
+ * Releases the calling thread's cached blocks. Happens on its own at thread
+ * exit unless POOL_NO_PTHREAD is defined; then call it before the thread
+ * returns. The pool stays usable afterwards.
+*/
+static void pool_thread_release(void)
+{
+	pool_drain(&pool_tls);
+}
+
+static Allocator pool_allocator(VectorPool *pool)
+{
+	Allocator a;
+
+	a.alloc = pool_alloc;
+	a.realloc = pool_realloc;
+	a.free = pool_free;
+	a.ctx = pool;
+	a.usable_size = pool_usable;
+	a.expand_in_place = NULL;
+	a.alloc_zeroed = NULL;
+	return (a);
+}
+
+/* Allocator backed by the calling thread's own pool. */
+static Allocator pool_thread_allocator(void)
+{
+	return (pool_allocator(NULL));
+}
+
+#endif // VECTOR_POOL_H
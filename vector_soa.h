@@ -0,0 +1,218 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_SOA.H v1.0.0
+   -----------------------------------------------------------------------------
+   Struct-of-arrays vector. Each field lives in its own column Vector with
+   its own elem_size, while all columns share one size and capacity, so a
+   loop over one field streams only that field's bytes.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/vector
+   License: MIT
+   -----------------------------------------------------------------------------
+
+   USAGE:
+	 enum { POS_X, POS_Y, MASS };
+	 size_t sizes[] = { sizeof(float), sizeof(float), sizeof(double) };
+	 VectorSoa bodies = soa_init(malloc_allocator(), 3, sizes);
+
+	 float x = 1.0f, y = 2.0f;
+	 double m = 10.0;
+	 const void *row[] = { &x, &y, &m };
+	 soa_push(&bodies, row);
+
+	 float *xs = soa_data(&bodies, POS_X, float);
+	 for (size_t i = 0; i < soa_size(&bodies); ++i)
+		 xs[i] += 1.0f;
+
+	 soa_destroy(&bodies);
+
+	 Each column is a regular Vector (soa_column), so read-only vector_*
+	 functions work on it. Anything that reorders or resizes a single column
+	 breaks the rows, use the soa_* modifiers for that.
+*/
+
+#ifndef VECTOR_SOA_H
+# define VECTOR_SOA_H
+
+#include "vector.h"
+
+#ifndef SOA_MAX_COLUMNS
+# define SOA_MAX_COLUMNS	16
+#endif
+
+typedef struct {
+	Vector	columns[SOA_MAX_COLUMNS];
+	size_t	count;		// number of columns
+	size_t	size;		// rows, mirrored into every column's size
+	size_t	capacity;	// smallest column capacity
+} VectorSoa;
+
+/* float *xs = soa_data(&bodies, POS_X, float); */
+#define soa_data(s, col, T) ((T *)(s)->columns[(col)].data)
+
+/* float x = soa_at(&bodies, POS_X, float, 0); */
+#define soa_at(s, col, T, idx) vector_at(&(s)->columns[(col)], T, (idx))
+
+/* ==================== */
+/* -- Initialization -- */
+/* ==================== */
+
+/* Every column gets its own buffer from alloc, aligned to align (0 = default). */
+static VectorSoa soa_init_aligned(Allocator alloc, size_t count, const size_t *elem_sizes, size_t align)
+{
+	assert(count > 0 && count <= SOA_MAX_COLUMNS && "column count out of range");
+	assert(elem_sizes != NULL && "elem_sizes is NULL");
+
+	VectorSoa s;
+	memset(&s, 0, sizeof(s));
+	s.count = count;
+	for (size_t c = 0; c < count; ++c)
+		s.columns[c] = vector_init_aligned(alloc, elem_sizes[c], align);
+	return (s);
+}
+
+static VectorSoa soa_init(Allocator alloc, size_t count, const size_t *elem_sizes)
+{
+	return (soa_init_aligned(alloc, count, elem_sizes, 0));
+}
+
+/* ==================== */
+/* -- Access         -- */
+/* ==================== */
+
+static inline size_t soa_size(const VectorSoa *s)
+{
+	return (s->size);
+}
+
+static inline Vector *soa_column(VectorSoa *s, size_t col)
+{
+	assert(col < s->count && "column out of range");
+	return (&s->columns[col]);
+}
+
+/* ==================== */
+/* -- Modifiers      -- */
+/* ==================== */
+
+static void soa_update_capacity(VectorSoa *s)
+{
+	size_t capacity = SIZE_MAX;
+
+	for (size_t c = 0; c < s->count; ++c)
+	{
+		if (s->columns[c].capacity < capacity)
+			capacity = s->columns[c].capacity;
+	}
+	s->capacity = capacity;
+}
+
+/* Reserves every column, stopping at the first one that fails. */
+static bool soa_reserve(VectorSoa *s, size_t new_capacity)
+{
+	assert(s != NULL && "soa_reserve: NULL argument");
+
+	bool ok = true;
+
+	for (size_t c = 0; c < s->count && ok; ++c)
+		ok = vector_reserve(&s->columns[c], new_capacity);
+	soa_update_capacity(s);
+	return (ok);
+}
+
+/*
+ * Grows column 0 by its growth policy until min_capacity rows fit, then
+ * brings the other columns up to the same capacity.
+*/
+static bool soa_grow_to(VectorSoa *s, size_t min_capacity)
+{
+	Vector *first = &s->columns[0];
+
+	if (!vector_resize_uninit(first, min_capacity))
+		return (false);
+	first->size = s->size;
+	return (soa_reserve(s, first->capacity));
+}
+
+static void soa_set_size(VectorSoa *s, size_t size)
+{
+	s->size = size;
+	for (size_t c = 0; c < s->count; ++c)
+		s->columns[c].size = size;
+}
+
+/* Appends one row, values holds one pointer per column. */
+static bool soa_push(VectorSoa *s, const void *const *values)
+{
+	assert(s != NULL && values != NULL && "soa_push: NULL argument");
+
+	if (s->size == s->capacity && !soa_grow_to(s, s->size + 1))
+		return (false);
+	for (size_t c = 0; c < s->count; ++c)
+	{
+		Vector *col = &s->columns[c];
+		memcpy((char *)col->data + s->size * col->elem_size, values[c], col->elem_size);
+	}
+	soa_set_size(s, s->size + 1);
+	return (true);
+}
+
+/* Appends count rows, values[c] points at count contiguous elements of column c. */
+static bool soa_push_n(VectorSoa *s, const void *const *values, size_t count)
+{
+	assert(s != NULL && values != NULL && "soa_push_n: NULL argument");
+
+	if (count > SIZE_MAX - s->size)
+		return (false);
+	if (s->capacity < s->size + count && !soa_grow_to(s, s->size + count))
+		return (false);
+	for (size_t c = 0; c < s->count; ++c)
+	{
+		Vector *col = &s->columns[c];
+		memcpy((char *)col->data + s->size * col->elem_size, values[c], count * col->elem_size);
+	}
+	soa_set_size(s, s->size + count);
+	return (true);
+}
+
+static bool soa_pop(VectorSoa *s)
+{
+	assert(s != NULL && s->size > 0 && "vector is empty");
+
+	if (!s || s->size == 0)
+		return (false);
+	soa_set_size(s, s->size - 1);
+	return (true);
+}
+
+/* O(1) row removal, moves the last row into index. Does NOT preserve order. */
+static bool soa_swap_pop(VectorSoa *s, size_t index)
+{
+	assert(s != NULL && index < s->size && "index out of bounds");
+
+	if (!s || index >= s->size)
+		return (false);
+	for (size_t c = 0; c < s->count; ++c)
+		vector_swap_pop(&s->columns[c], index);
+	s->size--;
+	return (true);
+}
+
+static void soa_clear(VectorSoa *s)
+{
+	if (s)
+		soa_set_size(s, 0);
+}
+
+static void soa_destroy(VectorSoa *s)
+{
+	if (!s)
+		return;
+
+	for (size_t c = 0; c < s->count; ++c)
+		vector_destroy(&s->columns[c]);
+	memset(s, 0, sizeof(*s));
+}
+
+#endif // VECTOR_SOA_H
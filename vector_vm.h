@@ -0,0 +1,198 @@
+/*
+   -----------------------------------------------------------------------------
+   VECTOR_VM.H v1.0.0
+   -----------------------------------------------------------------------------
+   Virtual-memory backed allocator for vector.h. Reserves a large address
+   range up front with mmap(PROT_NONE) and commits pages as the vector grows,
+   so data never moves and pointers into it stay valid across pushes.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/vector
+   License: MIT
+   -----------------------------------------------------------------------------
+
+   USAGE:
+	 VmRegion region;
+	 Vector v = vector_init_reserved(&region, sizeof(int), 1ull << 30, 0);
+	 ...
+	 vector_destroy(&v); // unmaps the whole reservation
+
+	 The region holds the allocator state and must outlive the vector, like
+	 an Arena does with arena_allocator. One region backs one vector.
+	 Pass VM_HUGE_PAGES to ask for transparent huge pages.
+
+	 MAP_ANONYMOUS, MAP_NORESERVE and madvise aren't ISO C, so under
+	 -std=c11 this header turns on _DEFAULT_SOURCE. That only works before
+	 the first system header, so include it first or define the macro
+	 yourself (or build with -std=gnu11).
+*/
+
+#ifndef VECTOR_VM_H
+# define VECTOR_VM_H
+
+#ifndef _DEFAULT_SOURCE
+# define _DEFAULT_SOURCE
+#endif
+
+#include "vector.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define VM_HUGE_PAGES	(1u << 0)	// madvise(MADV_HUGEPAGE), commit in 2 MiB steps
+#define VM_HUGE_PAGE_SIZE	((size_t)2 << 20)
+
+typedef struct {
+	char			*base;
+	size_t			reserved;
+	size_t			committed;
+	unsigned int	flags;
+} VmRegion;
+
+static size_t vm_granularity(const VmRegion *r)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+	if ((r->flags & VM_HUGE_PAGES) && page < VM_HUGE_PAGE_SIZE)
+		return (VM_HUGE_PAGE_SIZE);
+	return (page);
+}
+
+static size_t vm_round(const VmRegion *r, size_t size)
+{
+	size_t g = vm_granularity(r);
+
+	if (size > SIZE_MAX - (g - 1))
+		return (SIZE_MAX);
+	return ((size + g - 1) & ~(g - 1));
+}
+
+/* Makes [0, size) of the reservation accessible, or gives back the pages above it. */
+static bool vm_commit(VmRegion *r, size_t size)
+{
+	size_t target = vm_round(r, size);
+
+	if (target > r->reserved)
+		return (false);
+	if (target > r->committed)
+	{
+		if (mprotect(r->base + r->committed, target - r->committed, PROT_READ | PROT_WRITE) != 0)
+			return (false);
+	}
+	else if (target < r->committed)
+	{
+		madvise(r->base + target, r->committed - target, MADV_DONTNEED);
+		mprotect(r->base + target, r->committed - target, PROT_NONE);
+	}
+	r->committed = target;
+	return (true);
+}
+
+static void *vm_alloc(void *ctx, size_t size, size_t align)
+{
+	VmRegion *r = (VmRegion *)ctx;
+
+	assert(align <= vm_granularity(r) && "alignment larger than a page");
+	// A region only ever backs a single buffer
+	if (r->committed > 0)
+		return (NULL);
+	if (!r->base)
+	{
+		void *p = mmap(NULL, r->reserved, PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (p == MAP_FAILED)
+			return (NULL);
+		r->base = (char *)p;
+#ifdef MADV_HUGEPAGE
+		if (r->flags & VM_HUGE_PAGES)
+			madvise(r->base, r->reserved, MADV_HUGEPAGE);
+#endif
+	}
+	if (!vm_commit(r, size > 0 ? size : 1))
+		return (NULL);
+	return (r->base);
+}
+
+static bool vm_expand(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+	VmRegion *r = (VmRegion *)ctx;
+
+	(void)old_size;
+	if ((char *)ptr != r->base)
+		return (false);
+	return (vm_commit(r, new_size));
+}
+
+/* Grows or shrinks in place, the block never moves. */
+static void *vm_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size, size_t align)
+{
+	(void)align;
+	if (!vm_expand(ctx, ptr, old_size, new_size))
+		return (NULL);
+	return (ptr);
+}
+
+static size_t vm_usable(void *ctx, void *ptr, size_t size)
+{
+	VmRegion *r = (VmRegion *)ctx;
+
+	(void)ptr;
+	(void)size;
+	return (r->committed);
+}
+
+/*
+ * Unmaps the whole reservation, a later alloc maps a fresh one. Only the
+ * region's own block does that: vm_alloc never hands out another, so any
+ * other pointer is a caller bug and must not take the live vector with it.
+*/
+static void vm_free(void *ctx, void *ptr)
+{
+	VmRegion *r = (VmRegion *)ctx;
+
+	assert((!ptr || (char *)ptr == r->base) && "vm_free: not the region's block");
+	if (!ptr || (char *)ptr != r->base)
+		return;
+	munmap(r->base, r->reserved);
+	r->base = NULL;
+	r->committed = 0;
+}
+
+static Allocator vm_allocator(VmRegion *region)
+{
+	Allocator a;
+
+	a.alloc = vm_alloc;
+	a.realloc = vm_realloc;
+	a.free = vm_free;
+	a.ctx = region;
+	a.usable_size = vm_usable;
+	a.expand_in_place = vm_expand;
+	a.alloc_zeroed = vm_alloc;	// a region is always freshly mapped when alloc succeeds
+	return (a);
+}
+
+/*
+ * Sets up region to reserve room for max_capacity elements and returns a
+ * vector backed by it. Nothing is mapped until the first push or reserve.
+ * The vector's growth policy caps it at the reservation, so growing past
+ * it returns false like any full fixed-size vector; keep max_capacity set
+ * if you replace the policy with vector_set_growth.
+*/
+static Vector vector_init_reserved(VmRegion *region, size_t elem_size, size_t max_capacity, unsigned int flags)
+{
+	assert(region != NULL && "region is NULL");
+	assert(elem_size > 0 && max_capacity <= SIZE_MAX / elem_size && "reservation overflow");
+
+	region->base = NULL;
+	region->committed = 0;
+	region->flags = flags;
+	region->reserved = vm_round(region, max_capacity * elem_size);
+
+	Vector v = vector_init(vm_allocator(region), elem_size);
+	v.growth.max_capacity = region->reserved / elem_size;
+	if (v.growth.max_capacity == 0)
+		v.flags |= VECTOR_FIXED;	// 0 would mean no cap
+	return (v);
+}
+
+#endif // VECTOR_VM_H